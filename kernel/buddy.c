@@ -0,0 +1,195 @@
+// Buddy allocator for physically contiguous runs of pages.
+//
+// All memory in [end, PHYSTOP) is kept here as free blocks of
+// 2^order pages, 0 <= order < NORDER, each aligned in physical
+// memory to its own size. buddy_alloc() splits a larger block when
+// no block of the asked order is free; buddy_free() merges a block
+// with its buddy, the half it was split from, for as long as the
+// buddy is free as well. kalloc() and kfree() take and return single pages
+// here, in batches, through buddy_allocn() and buddy_freen().
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+#define NPAGE ((PHYSTOP - KERNBASE) / PGSIZE)
+
+extern char end[]; // first address after kernel.
+
+struct block {         // header kept in the first page of a free block
+  struct block *next;
+  struct block *prev;
+};
+
+static struct {
+  struct spinlock lock;
+  struct block free[NORDER];  // circular lists of free blocks, per order
+  uint64 nfree[NORDER];       // blocks on each list
+  signed char order[NPAGE];   // order of the free block a page starts, or -1
+} buddy;
+
+static inline int
+pgidx(uint64 pa)
+{
+  return (pa - KERNBASE) / PGSIZE;
+}
+
+static void
+push(struct block *b, int order)
+{
+  struct block *h = &buddy.free[order];
+
+  b->next = h->next;
+  b->prev = h;
+  h->next->prev = b;
+  h->next = b;
+  buddy.order[pgidx((uint64)b)] = order;
+  buddy.nfree[order]++;
+}
+
+static void
+unlink(struct block *b, int order)
+{
+  b->prev->next = b->next;
+  b->next->prev = b->prev;
+  buddy.order[pgidx((uint64)b)] = -1;
+  buddy.nfree[order]--;
+}
+
+// hand [pa_start, pa_end) to the allocator as the largest aligned
+// blocks that fit.
+void
+buddyinit(void *pa_start, void *pa_end)
+{
+  uint64 pa = PGROUNDUP((uint64)pa_start);
+  uint64 top = (uint64)pa_end;
+
+  initlock(&buddy.lock, "buddy");
+  for(int o = 0; o < NORDER; o++)
+    buddy.free[o].next = buddy.free[o].prev = &buddy.free[o];
+  memset(buddy.order, -1, sizeof(buddy.order));
+
+  while(pa + PGSIZE <= top){
+    int o = NORDER - 1;
+    while(o > 0 && (pa % (PGSIZE << o) != 0 || pa + (PGSIZE << o) > top))
+      o--;
+    push((struct block*)pa, o);
+    pa += PGSIZE << o;
+  }
+}
+
+// take a block of 2^order pages off the free lists. buddy.lock
+// must be held.
+static void*
+take(int order)
+{
+  struct block *b;
+  int o = order;
+
+  while(o < NORDER && buddy.free[o].next == &buddy.free[o])
+    o++;
+  if(o == NORDER)
+    return 0;
+  b = buddy.free[o].next;
+  unlink(b, o);
+  // give back the upper halves until the block is the right size.
+  while(o > order){
+    o--;
+    push((struct block*)((char*)b + (PGSIZE << o)), o);
+  }
+  return b;
+}
+
+// return a block of 2^order pages to the free lists, merging it
+// with its buddies. buddy.lock must be held.
+static void
+give(uint64 pa, int order)
+{
+  if(order < 0 || order >= NORDER || pa % (PGSIZE << order) != 0 ||
+     pa < PGROUNDUP((uint64)end) || pa + (PGSIZE << order) > PHYSTOP)
+    panic("buddy_free");
+  if(buddy.order[pgidx(pa)] >= 0)
+    panic("buddy_free: free block");
+
+  while(order < NORDER - 1){
+    uint64 bud = pa ^ (PGSIZE << order);
+    if(bud >= PHYSTOP || buddy.order[pgidx(bud)] != order)
+      break;
+    unlink((struct block*)bud, order);
+    if(bud < pa)
+      pa = bud;
+    order++;
+  }
+  push((struct block*)pa, order);
+}
+
+// allocate 2^order physically contiguous pages, aligned to their
+// size. returns 0 if no such block is left.
+void*
+buddy_alloc(int order)
+{
+  void *pa;
+
+  if(order < 0 || order >= NORDER)
+    return 0;
+  acquire(&buddy.lock);
+  pa = take(order);
+  release(&buddy.lock);
+  return pa;
+}
+
+// free a block that buddy_alloc(order) returned.
+void
+buddy_free(void *pa, int order)
+{
+  acquire(&buddy.lock);
+  give((uint64)pa, order);
+  release(&buddy.lock);
+}
+
+// allocate up to n single pages into pa[]. returns how many.
+int
+buddy_allocn(void **pa, int n)
+{
+  int i;
+
+  acquire(&buddy.lock);
+  for(i = 0; i < n && (pa[i] = take(0)) != 0; i++)
+    ;
+  release(&buddy.lock);
+  return i;
+}
+
+// free the n single pages in pa[].
+void
+buddy_freen(void **pa, int n)
+{
+  acquire(&buddy.lock);
+  for(int i = 0; i < n; i++)
+    give((uint64)pa[i], 0);
+  release(&buddy.lock);
+}
+
+// copy the number of free blocks of each order, up to n of them,
+// to user address addr. pages cached by kalloc() are not counted.
+// returns NORDER, or -1.
+int
+buddyinfo(uint64 addr, int n)
+{
+  uint64 counts[NORDER];
+
+  if(n < 0)
+    return -1;
+  if(n > NORDER)
+    n = NORDER;
+  acquire(&buddy.lock);
+  memmove(counts, buddy.nfree, sizeof(counts));
+  release(&buddy.lock);
+  if(copyout(myproc()->pagetable, addr, (char*)counts, n * sizeof(uint64)) < 0)
+    return -1;
+  return NORDER;
+}
@@ -0,0 +1,447 @@
+// Completely-fair scheduler run queue.
+//
+// Each cpu's struct runqueue holds, while proc_sched.algorithm is CFS,
+// one struct cfs_rq per scheduling group: a red-black tree of the
+// group's RUNNABLE processes ordered by virtual runtime. The tree links
+// live in struct proc itself, so enqueue and dequeue never allocate.
+// The leftmost (smallest vruntime) process is cached so picking within
+// a group is O(1).
+//
+// vruntime advances by the real run time (in ns, charged by update_curr()
+// in sched.c) scaled by NICE_0_WEIGHT/weight,
+// so a nice -5 process accumulates it about 3 times slower than a nice 0
+// one and gets about 3 times the cpu. Comparisons use the signed
+// difference, so wraparound of the uint64 counters is harmless.
+//
+// Groups are picked first, the same way: each cfs_rq has its own
+// vruntime on that cpu, advanced by the run time of its processes
+// scaled by NICE_0_WEIGHT/shares. cfs_pick() takes the group that is
+// furthest behind and not throttled (see sched.c), then its leftmost
+// process. With NGROUP small, the groups are simply scanned.
+//
+// Callers must hold rq->lock.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+// weight of each nice level, -20 .. 19. neighbouring levels differ by
+// about 1.25x, so one nice step changes a process's share by ~10%.
+static const int prio_to_weight[40] = {
+  /* -20 */ 88761, 71755, 56483, 46273, 36291,
+  /* -15 */ 29154, 23254, 18705, 14949, 11916,
+  /* -10 */  9548,  7620,  6100,  4904,  3906,
+  /*  -5 */  3121,  2501,  1991,  1586,  1277,
+  /*   0 */  1024,   820,   655,   526,   423,
+  /*   5 */   335,   272,   215,   172,   137,
+  /*  10 */   110,    87,    70,    56,    45,
+  /*  15 */    36,    29,    23,    18,    15,
+};
+
+int
+nice_to_weight(int nice)
+{
+  if(nice < NICE_MIN)
+    nice = NICE_MIN;
+  if(nice > NICE_MAX)
+    nice = NICE_MAX;
+  return prio_to_weight[nice - NICE_MIN];
+}
+
+// convert delta of real run time into virtual run time for weight.
+uint64
+cfs_scale(uint64 delta, int weight)
+{
+  return delta * NICE_0_WEIGHT / weight;
+}
+
+// true if a's vruntime is before b's.
+int
+vruntime_before(uint64 a, uint64 b)
+{
+  return (long)(a - b) < 0;
+}
+
+static void
+rotate_left(struct cfs_rq *cq, struct proc *x)
+{
+  struct proc *y = x->rb_right;
+
+  x->rb_right = y->rb_left;
+  if(y->rb_left)
+    y->rb_left->rb_parent = x;
+  y->rb_parent = x->rb_parent;
+  if(x->rb_parent == 0)
+    cq->root = y;
+  else if(x == x->rb_parent->rb_left)
+    x->rb_parent->rb_left = y;
+  else
+    x->rb_parent->rb_right = y;
+  y->rb_left = x;
+  x->rb_parent = y;
+}
+
+static void
+rotate_right(struct cfs_rq *cq, struct proc *x)
+{
+  struct proc *y = x->rb_left;
+
+  x->rb_left = y->rb_right;
+  if(y->rb_right)
+    y->rb_right->rb_parent = x;
+  y->rb_parent = x->rb_parent;
+  if(x->rb_parent == 0)
+    cq->root = y;
+  else if(x == x->rb_parent->rb_right)
+    x->rb_parent->rb_right = y;
+  else
+    x->rb_parent->rb_left = y;
+  y->rb_right = x;
+  x->rb_parent = y;
+}
+
+static int
+is_red(struct proc *p)
+{
+  return p != 0 && p->rb_red;
+}
+
+// replace the subtree rooted at u with the one rooted at v.
+static void
+transplant(struct cfs_rq *cq, struct proc *u, struct proc *v)
+{
+  if(u->rb_parent == 0)
+    cq->root = v;
+  else if(u == u->rb_parent->rb_left)
+    u->rb_parent->rb_left = v;
+  else
+    u->rb_parent->rb_right = v;
+  if(v)
+    v->rb_parent = u->rb_parent;
+}
+
+static struct proc*
+subtree_min(struct proc *p)
+{
+  while(p->rb_left)
+    p = p->rb_left;
+  return p;
+}
+
+// add the group run time update_curr() charged to rq's groups
+// without rq->lock to their vruntimes. update_curr() adds to charge
+// atomically and this swaps it out, so none is lost. rq->lock must
+// be held.
+void
+cfs_fold(struct runqueue *rq)
+{
+  for(struct cfs_rq *cq = rq->cfs; cq < &rq->cfs[NGROUP]; cq++)
+    if(cq->charge != 0)
+      cq->vruntime += __sync_lock_test_and_set(&cq->charge, 0);
+}
+
+// p, the best process of its group, is being taken to run: raise the
+// group's min_vruntime to the smallest vruntime still waiting, and
+// the cpu's group floor to the group's own vruntime. neither ever
+// decreases, so woken processes and groups cannot be placed behind
+// time that has already been handed out.
+void
+cfs_update_min_vruntime(struct runqueue *rq, struct proc *p)
+{
+  struct cfs_rq *cq = &rq->cfs[p->group];
+  uint64 vruntime = p->vruntime;
+
+  cfs_fold(rq);
+  if(cq->leftmost && vruntime_before(cq->leftmost->vruntime, vruntime))
+    vruntime = cq->leftmost->vruntime;
+  if(vruntime_before(cq->min_vruntime, vruntime))
+    cq->min_vruntime = vruntime;
+  if(vruntime_before(rq->group_min_vruntime, cq->vruntime))
+    rq->group_min_vruntime = cq->vruntime;
+}
+
+// p is joining rq after sleeping, or for the first time. it keeps its
+// own vruntime if that is recent, but is otherwise moved up to half a
+// target latency before its group's min_vruntime: enough credit to run
+// soon after waking, not enough to monopolize the cpu after a long sleep.
+void
+cfs_place(struct runqueue *rq, struct proc *p)
+{
+  uint64 credit = proc_sched.sched_latency / 2;
+  uint64 floor = rq->cfs[p->group].min_vruntime - credit;
+
+  if(vruntime_before(p->vruntime, floor))
+    p->vruntime = floor;
+}
+
+// insert p into its group's tree, keyed on p->vruntime. equal keys go
+// to the right, so processes with the same vruntime run in FIFO order.
+// a group that had nothing waiting is placed like a woken process.
+void
+cfs_enqueue(struct runqueue *rq, struct proc *p)
+{
+  struct cfs_rq *cq = &rq->cfs[p->group];
+  struct proc **link = &cq->root;
+  struct proc *parent = 0;
+  int leftmost = 1;
+
+  cfs_fold(rq);
+  if(cq->nr == 0){
+    uint64 floor = rq->group_min_vruntime - proc_sched.sched_latency / 2;
+    if(vruntime_before(cq->vruntime, floor))
+      cq->vruntime = floor;
+  }
+
+  while(*link){
+    parent = *link;
+    if(vruntime_before(p->vruntime, parent->vruntime)){
+      link = &parent->rb_left;
+    } else {
+      link = &parent->rb_right;
+      leftmost = 0;
+    }
+  }
+
+  p->rb_parent = parent;
+  p->rb_left = p->rb_right = 0;
+  p->rb_red = 1;
+  *link = p;
+  if(leftmost)
+    cq->leftmost = p;
+  cq->load += p->weight;
+  cq->nr++;
+
+  // restore the red-black properties.
+  struct proc *x = p;
+  while(is_red(x->rb_parent)){
+    struct proc *xp = x->rb_parent;
+    struct proc *g = xp->rb_parent;
+    if(xp == g->rb_left){
+      struct proc *u = g->rb_right;
+      if(is_red(u)){
+        xp->rb_red = 0;
+        u->rb_red = 0;
+        g->rb_red = 1;
+        x = g;
+      } else {
+        if(x == xp->rb_right){
+          x = xp;
+          rotate_left(cq, x);
+          xp = x->rb_parent;
+        }
+        xp->rb_red = 0;
+        g->rb_red = 1;
+        rotate_right(cq, g);
+      }
+    } else {
+      struct proc *u = g->rb_left;
+      if(is_red(u)){
+        xp->rb_red = 0;
+        u->rb_red = 0;
+        g->rb_red = 1;
+        x = g;
+      } else {
+        if(x == xp->rb_left){
+          x = xp;
+          rotate_right(cq, x);
+          xp = x->rb_parent;
+        }
+        xp->rb_red = 0;
+        g->rb_red = 1;
+        rotate_left(cq, g);
+      }
+    }
+  }
+  cq->root->rb_red = 0;
+}
+
+// remove p, which must be in its group's tree in rq.
+void
+cfs_dequeue(struct runqueue *rq, struct proc *p)
+{
+  struct cfs_rq *cq = &rq->cfs[p->group];
+  struct proc *x, *xparent, *y;
+  int removed_red;
+
+  if(cq->leftmost == p)
+    cq->leftmost = p->rb_right ? subtree_min(p->rb_right) : p->rb_parent;
+  cq->load -= p->weight;
+  cq->nr--;
+
+  removed_red = p->rb_red;
+  if(p->rb_left == 0){
+    x = p->rb_right;
+    xparent = p->rb_parent;
+    transplant(cq, p, p->rb_right);
+  } else if(p->rb_right == 0){
+    x = p->rb_left;
+    xparent = p->rb_parent;
+    transplant(cq, p, p->rb_left);
+  } else {
+    y = subtree_min(p->rb_right);
+    removed_red = y->rb_red;
+    x = y->rb_right;
+    if(y->rb_parent == p){
+      xparent = y;
+    } else {
+      xparent = y->rb_parent;
+      transplant(cq, y, y->rb_right);
+      y->rb_right = p->rb_right;
+      y->rb_right->rb_parent = y;
+    }
+    transplant(cq, p, y);
+    y->rb_left = p->rb_left;
+    y->rb_left->rb_parent = y;
+    y->rb_red = p->rb_red;
+  }
+  p->rb_parent = p->rb_left = p->rb_right = 0;
+
+  if(removed_red)
+    return;
+
+  // x carries an extra black; push it up until it can be absorbed.
+  while(x != cq->root && !is_red(x)){
+    if(x == xparent->rb_left){
+      struct proc *w = xparent->rb_right;
+      if(is_red(w)){
+        w->rb_red = 0;
+        xparent->rb_red = 1;
+        rotate_left(cq, xparent);
+        w = xparent->rb_right;
+      }
+      if(!is_red(w->rb_left) && !is_red(w->rb_right)){
+        w->rb_red = 1;
+        x = xparent;
+        xparent = x->rb_parent;
+      } else {
+        if(!is_red(w->rb_right)){
+          w->rb_left->rb_red = 0;
+          w->rb_red = 1;
+          rotate_right(cq, w);
+          w = xparent->rb_right;
+        }
+        w->rb_red = xparent->rb_red;
+        xparent->rb_red = 0;
+        if(w->rb_right)
+          w->rb_right->rb_red = 0;
+        rotate_left(cq, xparent);
+        x = cq->root;
+      }
+    } else {
+      struct proc *w = xparent->rb_left;
+      if(is_red(w)){
+        w->rb_red = 0;
+        xparent->rb_red = 1;
+        rotate_right(cq, xparent);
+        w = xparent->rb_left;
+      }
+      if(!is_red(w->rb_left) && !is_red(w->rb_right)){
+        w->rb_red = 1;
+        x = xparent;
+        xparent = x->rb_parent;
+      } else {
+        if(!is_red(w->rb_left)){
+          w->rb_right->rb_red = 0;
+          w->rb_red = 1;
+          rotate_left(cq, w);
+          w = xparent->rb_left;
+        }
+        w->rb_red = xparent->rb_red;
+        xparent->rb_red = 0;
+        if(w->rb_left)
+          w->rb_left->rb_red = 0;
+        rotate_right(cq, xparent);
+        x = cq->root;
+      }
+    }
+  }
+  if(x)
+    x->rb_red = 0;
+}
+
+// the group that should run next on rq: of those with processes
+// waiting and not throttled, the one with the smallest vruntime.
+// -1 if there is none.
+int
+cfs_pick_group(struct runqueue *rq)
+{
+  int best = -1;
+
+  cfs_fold(rq);
+  for(int g = 0; g < NGROUP; g++){
+    struct cfs_rq *cq = &rq->cfs[g];
+    if(cq->nr == 0 || sched_groups[g].throttled)
+      continue;
+    if(best < 0 || vruntime_before(cq->vruntime, rq->cfs[best].vruntime))
+      best = g;
+  }
+  return best;
+}
+
+// the process to run next: the leftmost one of cfs_pick_group(),
+// or 0 if every group is empty or throttled.
+struct proc*
+cfs_pick(struct runqueue *rq)
+{
+  int g = cfs_pick_group(rq);
+
+  return g < 0 ? 0 : rq->cfs[g].leftmost;
+}
+
+// the leftmost process of any group, throttled or not, or 0 if
+// rq has none. for emptying the queue.
+struct proc*
+cfs_any(struct runqueue *rq)
+{
+  for(int g = 0; g < NGROUP; g++)
+    if(rq->cfs[g].leftmost)
+      return rq->cfs[g].leftmost;
+  return 0;
+}
+
+// queue p ahead of everything else in its group.
+void
+cfs_enqueue_front(struct runqueue *rq, struct proc *p)
+{
+  struct proc *first = rq->cfs[p->group].leftmost;
+
+  if(first != 0 && !vruntime_before(p->vruntime, first->vruntime))
+    p->vruntime = first->vruntime - 1;
+  cfs_enqueue(rq, p);
+}
+
+// the process after p in its group's vruntime order, or 0.
+struct proc*
+cfs_next(struct proc *p)
+{
+  if(p->rb_right)
+    return subtree_min(p->rb_right);
+  while(p->rb_parent && p == p->rb_parent->rb_right)
+    p = p->rb_parent;
+  return p->rb_parent;
+}
+
+// how long p should run before being preempted: its group's share
+// of the target latency among the groups waiting in rq, and p's
+// weighted share of that among its group, but never less than the
+// minimum granularity.
+uint64
+cfs_timeslice(struct runqueue *rq, struct proc *p)
+{
+  struct cfs_rq *cq = &rq->cfs[p->group];
+  uint64 shares = 0;
+
+  for(int g = 0; g < NGROUP; g++)
+    if(rq->cfs[g].nr > 0 || g == p->group)
+      shares += sched_groups[g].shares;
+
+  uint64 slice = proc_sched.sched_latency * sched_groups[p->group].shares / shares;
+  slice = slice * p->weight / (cq->load + p->weight);
+  if(slice < proc_sched.quantum[1])
+    slice = proc_sched.quantum[1];
+  return slice;
+}
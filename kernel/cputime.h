@@ -0,0 +1,9 @@
+// Scheduler time accounting for one process, see getcputime().
+// All times are in nanoseconds, measured with the CLINT's mtime.
+struct cputime {
+  uint64 run;          // total time on a cpu
+  uint64 wait;         // total time RUNNABLE in a run queue
+  uint64 burst;        // length of the current or most recent cpu burst
+  uint64 burst_aprox;  // sjf prediction of the next burst
+  uint64 vruntime;     // cfs virtual runtime
+};
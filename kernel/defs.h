@@ -3,12 +3,15 @@ struct context;
 struct file;
 struct inode;
 struct pipe;
+struct slabcache;
 struct proc;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
 struct sched_policy;
+struct runqueue;
+struct prioq;
 
 // bio.c
 void            binit(void);
@@ -18,6 +21,33 @@ void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
 
+// cfs.c
+int             nice_to_weight(int);
+uint64          cfs_scale(uint64, int);
+int             vruntime_before(uint64, uint64);
+void            cfs_place(struct runqueue*, struct proc*);
+void            cfs_fold(struct runqueue*);
+void            cfs_update_min_vruntime(struct runqueue*, struct proc*);
+void            cfs_enqueue(struct runqueue*, struct proc*);
+void            cfs_enqueue_front(struct runqueue*, struct proc*);
+void            cfs_dequeue(struct runqueue*, struct proc*);
+int             cfs_pick_group(struct runqueue*);
+struct proc*    cfs_pick(struct runqueue*);
+struct proc*    cfs_any(struct runqueue*);
+struct proc*    cfs_next(struct proc*);
+uint64          cfs_timeslice(struct runqueue*, struct proc*);
+
+// mlfq.c
+uint64          mlfq_timeslice(struct proc*);
+void            mlfq_boost(struct runqueue*);
+
+// prioq.c
+void            prioq_push(struct prioq*, struct proc*, int);
+void            prioq_push_front(struct prioq*, struct proc*, int);
+void            prioq_remove(struct prioq*, struct proc*, int);
+int             prioq_top(struct prioq*);
+struct proc*    prioq_first(struct prioq*);
+
 // console.c
 void            consoleinit(void);
 void            consoleintr(int);
@@ -60,10 +90,27 @@ void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// buddy.c
+void            buddyinit(void*, void*);
+void*           buddy_alloc(int);
+void            buddy_free(void*, int);
+int             buddy_allocn(void**, int);
+void            buddy_freen(void**, int);
+int             buddyinfo(uint64, int);
+
 // kalloc.c
 void*           kalloc(void);
 void            kfree(void *);
 void            kinit(void);
+void*           kalloc_zeroed(void);
+int             kzero_fill(void);
+void            kdup(void *);
+int             krefcount(void *);
+
+// slab.c
+void            slabinit(struct slabcache*, char*, uint, void (*)(void*));
+void*           slaballoc(struct slabcache*);
+void            slabfree(struct slabcache*, void*);
 
 // log.c
 void            initlog(int, struct superblock*);
@@ -72,6 +119,7 @@ void            begin_op(void);
 void            end_op(void);
 
 // pipe.c
+void            pipeinit(void);
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, uint64, int);
@@ -105,17 +153,41 @@ void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
+int             setnice(int, int);
+int             setsched(int, int, int);
+int             setaffinity(int, uint64);
+int             setgroup(int, int);
+int             setgang(int, int);
+int             getcputime(int, uint64);
+int             schedstat(int, uint64);
 
+// sched.c
 void            put(struct proc*);
 struct proc*    get();
 void            heapify_up(struct proc**, int n, int algo);
-void            heapify_down(struct proc**, int n, int algo);
 void            heapify_down_i(struct proc**, int n, int i, int algo);
-
-int             change_sched(int, int, int);
-void            rearrange_heap(struct proc**, int n, int algo);
-
+void            heap_decrease_key(struct proc**, int i, int algo);
+void            heap_increase_key(struct proc**, int n, int i, int algo);
+struct proc*    heap_remove(struct proc**, int *n, int i, int algo);
+void            requeue_front(struct proc*);
+void            reweight(struct proc*, int);
+void            setclass(struct proc*, int, int);
+void            set_cpus_allowed(struct proc*, uint64);
+void            regroup(struct proc*, int);
+void            gang_place(struct proc*, int, uint64);
+void            groupinit(void);
+int             groupctl(int, int, int, int);
+int             can_steal(struct cpu*);
+int             cpu_has_work(struct cpu*);
+int             change_sched(int, int, int, int);
+int             settick(int);
+int             setquantum(int, int);
+int             setcachetol(int);
+int             setlatency(int);
+int             setboost(int);
+void            update_curr(struct proc*);
 void            timer_routine(struct proc*);
+void            ipi_routine(struct proc*);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -128,12 +200,23 @@ void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
 
+// schedtrace.c
+void            schedtraceinit(void);
+void            trace_sched(int, struct proc*, int, int);
+int             schedtrace(uint64, int);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
 
+// start.c
+int             timer_fired(void);
+void            timer_stop(void);
+void            timer_start(void);
+void            timer_setinterval(uint64);
+
 // string.c
 int             memcmp(const void*, const void*, uint);
 void*           memmove(void*, const void*, uint);
@@ -153,10 +236,13 @@ void            syscall();
 
 // trap.c
 extern uint     ticks;
+extern uint     ticksleepers;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+void            send_ipi(int);
+uint64          sched_clock(void);
 
 void            timer_routine(struct proc*);
 
@@ -177,6 +263,7 @@ void            uvminit(pagetable_t, uchar *, uint);
 uint64          uvmalloc(pagetable_t, uint64, uint64);
 uint64          uvmdealloc(pagetable_t, uint64, uint64);
 int             uvmcopy(pagetable_t, pagetable_t, uint64);
+int             cowfault(pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
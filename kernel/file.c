@@ -8,6 +8,7 @@
 #include "param.h"
 #include "fs.h"
 #include "spinlock.h"
+#include "slab.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "stat.h"
@@ -15,14 +16,21 @@
 
 struct devsw devsw[NDEV];
 struct {
-  struct spinlock lock;
-  struct file file[NFILE];
+  struct spinlock lock;   // protects the ref counts
+  struct slabcache cache; // file structures, allocated as needed
 } ftable;
 
+static void
+filector(void *f)
+{
+  memset(f, 0, sizeof(struct file));
+}
+
 void
 fileinit(void)
 {
   initlock(&ftable.lock, "ftable");
+  slabinit(&ftable.cache, "file", sizeof(struct file), filector);
 }
 
 // Allocate a file structure.
@@ -31,16 +39,10 @@ filealloc(void)
 {
   struct file *f;
 
-  acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
-  }
-  release(&ftable.lock);
-  return 0;
+  if((f = slaballoc(&ftable.cache)) == 0)
+    return 0;
+  f->ref = 1;
+  return f;
 }
 
 // Increment ref count for file f.
@@ -69,9 +71,10 @@ fileclose(struct file *f)
     return;
   }
   ff = *f;
-  f->ref = 0;
-  f->type = FD_NONE;
   release(&ftable.lock);
+  // back to the state filector() leaves it in, as slabfree() expects.
+  filector(f);
+  slabfree(&ftable.cache, f);
 
   if(ff.type == FD_PIPE){
     pipeclose(ff.pipe, ff.writable);
@@ -1,6 +1,22 @@
 // Physical memory allocator, for user processes,
 // kernel stacks, page-table pages,
 // and pipe buffers. Allocates whole 4096-byte pages.
+//
+// Each cpu keeps a magazine of free pages in front of the buddy
+// allocator in buddy.c, which owns all of memory. kalloc() and
+// kfree() work on the calling cpu's magazine, under its own lock,
+// which only a cpu that ran out of pages ever contends; pages move
+// between a magazine and the buddy allocator KMAG_BATCH at a time,
+// so most calls never take the buddy lock.
+//
+// Idle harts zero free pages ahead of time into the kzero pool,
+// which kalloc_zeroed() draws from, so callers that need a clean
+// page rarely clear one themselves. Freed and allocated pages are
+// filled with junk only when built with KALLOC_DEBUG.
+//
+// Each page handed out has a reference count, so that fork() can
+// share pages copy-on-write: kdup() adds a reference and kfree()
+// frees the page only when the last one goes.
 
 #include "types.h"
 #include "param.h"
@@ -9,7 +25,9 @@
 #include "riscv.h"
 #include "defs.h"
 
-void freerange(void *pa_start, void *pa_end);
+#define KMAG_BATCH 32               // pages moved to or from buddy.c at once
+#define KMAG_MAX   (2 * KMAG_BATCH) // a magazine drains when it has more
+#define KZERO_MAX  256              // zeroed pages idle harts keep ready
 
 extern char end[]; // first address after kernel.
                    // defined by kernel.ld.
@@ -18,65 +36,256 @@ struct run {
   struct run *next;
 };
 
+struct kmag {
+  struct spinlock lock;
+  struct run *freelist;
+  int n;                      // pages in freelist
+  struct run *zeroed;         // pages taken from kzero
+  int nzeroed;
+} __attribute__ ((aligned (64)));
+
+struct kmag kmags[NCPU];
+
+int krefs[(PHYSTOP - KERNBASE) / PGSIZE];
+#define PA2REF(pa) (((uint64)(pa) - KERNBASE) / PGSIZE)
+
+// pages zeroed by idle harts. a zeroed page is all zero except
+// for the run link in its first word.
 struct {
   struct spinlock lock;
   struct run *freelist;
-} kmem;
+  int n;
+} kzero;
 
 void
 kinit()
 {
-  initlock(&kmem.lock, "kmem");
-  freerange(end, (void*)PHYSTOP);
+  initlock(&kzero.lock, "kzero");
+  for(struct kmag *m = kmags; m < &kmags[NCPU]; m++)
+    initlock(&m->lock, "kmag");
+  buddyinit(end, (void*)PHYSTOP);
+}
+
+// lock and return the calling cpu's magazine. holding its lock
+// keeps interrupts off, so the caller cannot move to another cpu.
+static struct kmag*
+mymag(void)
+{
+  push_off();
+  struct kmag *m = &kmags[cpuid()];
+  acquire(&m->lock);
+  pop_off();
+  return m;
+}
+
+// give KMAG_BATCH pages from m back to buddy.c. m->lock must be held.
+static void
+drain(struct kmag *m)
+{
+  void *pa[KMAG_BATCH];
+
+  for(int i = 0; i < KMAG_BATCH; i++){
+    pa[i] = m->freelist;
+    m->freelist = m->freelist->next;
+  }
+  m->n -= KMAG_BATCH;
+  buddy_freen(pa, KMAG_BATCH);
+}
+
+// fill the empty m with up to KMAG_BATCH pages from buddy.c.
+// m->lock must be held.
+static void
+refill(struct kmag *m)
+{
+  void *pa[KMAG_BATCH];
+  int n = buddy_allocn(pa, KMAG_BATCH);
+
+  for(int i = n - 1; i >= 0; i--){
+    struct run *r = pa[i];
+    r->next = m->freelist;
+    m->freelist = r;
+  }
+  m->n = n;
+}
+
+// take a page from m, dirty ones first. m->lock must be held.
+static struct run*
+take(struct kmag *m)
+{
+  struct run *r;
+
+  if((r = m->freelist) != 0){
+    m->freelist = r->next;
+    m->n--;
+  } else if((r = m->zeroed) != 0){
+    m->zeroed = r->next;
+    m->nzeroed--;
+  }
+  return r;
+}
+
+// buddy.c is empty too: take a page from another cpu's magazine,
+// or from the zeroed pool. called without any magazine lock held,
+// so two cpus doing this cannot deadlock.
+static struct run*
+steal(void)
+{
+  struct run *r = 0;
+
+  for(struct kmag *m = kmags; m < &kmags[NCPU] && r == 0; m++){
+    if(m->n == 0 && m->nzeroed == 0)
+      continue;
+    acquire(&m->lock);
+    r = take(m);
+    release(&m->lock);
+  }
+  if(r == 0){
+    acquire(&kzero.lock);
+    if((r = kzero.freelist) != 0){
+      kzero.freelist = r->next;
+      kzero.n--;
+    }
+    release(&kzero.lock);
+  }
+  return r;
 }
 
+// Add a reference to a page that kalloc() returned.
 void
-freerange(void *pa_start, void *pa_end)
+kdup(void *pa)
+{
+  if(__sync_fetch_and_add(&krefs[PA2REF(pa)], 1) < 1)
+    panic("kdup");
+}
+
+// Return the number of references to a page.
+int
+krefcount(void *pa)
 {
-  char *p;
-  p = (char*)PGROUNDUP((uint64)pa_start);
-  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE)
-    kfree(p);
+  return krefs[PA2REF(pa)];
 }
 
-// Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// Drop a reference to the page of physical memory pointed
+// at by v, which normally should have been returned by a
+// call to kalloc(), and free it if that was the last one.
 void
 kfree(void *pa)
 {
   struct run *r;
+  struct kmag *m;
+  int n;
 
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+  if((n = __sync_sub_and_fetch(&krefs[PA2REF(pa)], 1)) > 0)
+    return;
+  if(n < 0)
+    panic("kfree: free page");
+
+#ifdef KALLOC_DEBUG
   // Fill with junk to catch dangling refs.
   memset(pa, 1, PGSIZE);
+#endif
 
   r = (struct run*)pa;
 
-  acquire(&kmem.lock);
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  release(&kmem.lock);
+  m = mymag();
+  r->next = m->freelist;
+  m->freelist = r;
+  m->n++;
+  if(m->n > KMAG_MAX)
+    drain(m);
+  release(&m->lock);
 }
 
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
+// The page holds whatever was there before.
 void *
 kalloc(void)
 {
   struct run *r;
+  struct kmag *m;
+
+  m = mymag();
+  if(m->n == 0)
+    refill(m);
+  r = take(m);
+  release(&m->lock);
+
+  if(r == 0)
+    r = steal();
+
+  if(r == 0)
+    return 0;
+  krefs[PA2REF(r)] = 1;
+#ifdef KALLOC_DEBUG
+  memset((char*)r, 5, PGSIZE); // fill with junk
+#endif
+  return (void*)r;
+}
+
+// Allocate one page of physical memory filled with zeros,
+// preferably one an idle hart already cleared.
+// Returns 0 if the memory cannot be allocated.
+void *
+kalloc_zeroed(void)
+{
+  struct run *r;
+  struct kmag *m;
 
-  acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  release(&kmem.lock);
+  m = mymag();
+  if(m->nzeroed == 0 && kzero.n > 0){
+    acquire(&kzero.lock);
+    while(m->nzeroed < KMAG_BATCH && (r = kzero.freelist) != 0){
+      kzero.freelist = r->next;
+      kzero.n--;
+      r->next = m->zeroed;
+      m->zeroed = r;
+      m->nzeroed++;
+    }
+    release(&kzero.lock);
+  }
+  if((r = m->zeroed) != 0){
+    m->zeroed = r->next;
+    m->nzeroed--;
+  }
+  release(&m->lock);
 
-  if(r)
-    memset((char*)r, 5, PGSIZE); // fill with junk
+  if(r){
+    r->next = 0;
+    krefs[PA2REF(r)] = 1;
+    return (void*)r;
+  }
+  if((r = kalloc()) != 0)
+    memset((char*)r, 0, PGSIZE);
   return (void*)r;
 }
+
+// Called by an idle hart: zero up to KMAG_BATCH free pages into
+// kzero. Returns how many it zeroed, 0 once the pool is full or
+// memory runs short.
+int
+kzero_fill(void)
+{
+  void *pa[KMAG_BATCH];
+  int n;
+
+  if(kzero.n >= KZERO_MAX)
+    return 0;
+  n = buddy_allocn(pa, KMAG_BATCH);
+  for(int i = 0; i < n; i++)
+    memset(pa[i], 0, PGSIZE);
+
+  acquire(&kzero.lock);
+  for(int i = 0; i < n; i++){
+    struct run *r = pa[i];
+    r->next = kzero.freelist;
+    kzero.freelist = r;
+  }
+  kzero.n += n;
+  release(&kzero.lock);
+  return n;
+}
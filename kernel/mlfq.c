@@ -0,0 +1,41 @@
+// Multi-level feedback queue policy.
+//
+// While proc_sched.algorithm is MLFQ, each cpu's run queue keeps its
+// RUNNABLE processes in rq->mlfq, a prioq (prioq.c) with one fifo list
+// per level, level 0 first.
+//
+// A process at level i runs for quantum[2] << i before it is
+// preempted. put() moves it one level down when it used its whole
+// quantum and one level up when it slept before that. Every mlfq_boost
+// ns each cpu moves everything it has back to level 0, so processes
+// that were pushed down cannot starve.
+//
+// Callers must hold rq->lock.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+uint64
+mlfq_timeslice(struct proc *p)
+{
+  return proc_sched.quantum[2] << p->mlfq_level;
+}
+
+// move every process waiting in rq to level 0, keeping their order.
+void
+mlfq_boost(struct runqueue *rq)
+{
+  for(int l = 1; l < MLFQ_LEVELS; l++){
+    struct proc *p;
+    while((p = rq->mlfq.head[l]) != 0){
+      prioq_remove(&rq->mlfq, p, l);
+      p->mlfq_level = 0;
+      prioq_push(&rq->mlfq, p, 0);
+    }
+  }
+}
@@ -1,7 +1,6 @@
 #define NPROC        64  // maximum number of processes
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
@@ -11,3 +10,18 @@
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       1000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define SCHED_BALANCE_TICKS 4  // timer interrupts between run queue rebalances
+#define SCHED_TRACE_LEN 256    // scheduler trace events kept per cpu
+#define NSCHED        3    // number of scheduling algorithms, see change_sched()
+#define MLFQ_LEVELS   4    // priority levels of the MLFQ algorithm
+#define NRTPRIO      32    // real-time priorities, 0 highest
+#define NPRIOQ       32    // priorities of a struct prioq, at most 32
+#define CPUMASK_ALL  ((1UL << NCPU) - 1)  // affinity mask allowing every cpu
+#ifndef TICK_USEC
+#define TICK_USEC 100000   // default timer interrupt interval, microseconds
+#endif
+#define NICE_MIN     -20   // highest CFS priority
+#define NICE_MAX      19   // lowest CFS priority
+#define NICE_0_WEIGHT 1024 // CFS load weight of a nice 0 process
+#define NGROUP        8    // CFS scheduling groups, see setgroup()
+#define NORDER       11    // buddy allocator block orders, 1 to 1024 pages
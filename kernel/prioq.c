@@ -0,0 +1,93 @@
+// Priority-indexed fifo lists of processes.
+//
+// A struct prioq holds one fifo list per priority, 0 first, and a
+// bitmap of the non-empty ones, so the first process of the highest
+// priority is found in O(1). Run queues use one for the MLFQ levels
+// and one for the real-time class. The list links live in struct proc;
+// a process is in at most one list.
+//
+// Callers must hold the lock of the run queue the prioq is in.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+// index of the lowest set bit of the non-zero x. a de Bruijn
+// multiply rather than __builtin_ctz, which without Zbb becomes a
+// call into libgcc, and the kernel does not link against libgcc.
+static int
+lowest(uint x)
+{
+  static const char pos[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9,
+  };
+  return pos[((x & -x) * 0x077CB531U) >> 27];
+}
+
+// append p to the list of priority prio.
+void
+prioq_push(struct prioq *q, struct proc *p, int prio)
+{
+  p->q_next = 0;
+  p->q_prev = q->tail[prio];
+  if(q->tail[prio])
+    q->tail[prio]->q_next = p;
+  else
+    q->head[prio] = p;
+  q->tail[prio] = p;
+  q->bitmap |= 1U << prio;
+}
+
+// put p first in the list of priority prio.
+void
+prioq_push_front(struct prioq *q, struct proc *p, int prio)
+{
+  p->q_prev = 0;
+  p->q_next = q->head[prio];
+  if(q->head[prio])
+    q->head[prio]->q_prev = p;
+  else
+    q->tail[prio] = p;
+  q->head[prio] = p;
+  q->bitmap |= 1U << prio;
+}
+
+// remove p, which must be in the list of priority prio.
+void
+prioq_remove(struct prioq *q, struct proc *p, int prio)
+{
+  if(p->q_prev)
+    p->q_prev->q_next = p->q_next;
+  else
+    q->head[prio] = p->q_next;
+  if(p->q_next)
+    p->q_next->q_prev = p->q_prev;
+  else
+    q->tail[prio] = p->q_prev;
+  p->q_next = p->q_prev = 0;
+  if(q->head[prio] == 0)
+    q->bitmap &= ~(1U << prio);
+}
+
+// the highest non-empty priority, or NPRIOQ if q is empty.
+int
+prioq_top(struct prioq *q)
+{
+  if(q->bitmap == 0)
+    return NPRIOQ;
+  return lowest(q->bitmap);
+}
+
+// the first process of the highest non-empty priority, or 0.
+struct proc*
+prioq_first(struct prioq *q)
+{
+  if(q->bitmap == 0)
+    return 0;
+  return q->head[lowest(q->bitmap)];
+}
@@ -4,15 +4,16 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "sched.h"
+#include "cputime.h"
+#include "schedstat.h"
+#include "schedtrace.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
 
 struct proc proc[NPROC];
 
-// initial scheduling policy is shortest-job-first
-struct sched_policy proc_sched = { .heap_size = 0, .a = 50, .algorithm = 0, .is_preemptive = 0};
-
 struct proc *initproc;
 
 int nextpid = 1;
@@ -20,6 +21,8 @@ struct spinlock pid_lock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void idle(struct cpu *c);
+static void coschedule(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
 
@@ -50,9 +53,14 @@ void
 procinit(void)
 {
   struct proc *p;
+  struct cpu *c;
   
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
+  initlock(&proc_sched.lock, "sched");
+  groupinit();
+  for(c = cpus; c < &cpus[NCPU]; c++)
+      initlock(&c->rq.lock, "runqueue");
   for(p = proc; p < &proc[NPROC]; p++) {
       initlock(&p->lock, "proc");
       p->kstack = KSTACK((int) (p - proc));
@@ -126,7 +134,27 @@ found:
   p->cpu_burst = 0;
   p->timeslice = 0;
   p->put_timestamp = 0;
-  p->exe_time = 0;
+  p->run_start = 0;
+  p->run_time = 0;
+  p->wait_time = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->last_burst = 0;
+  p->last_burst_aprox = 0;
+  p->last_cpu = -1;
+  p->nr_migrations = 0;
+  p->nice = 0;
+  p->weight = NICE_0_WEIGHT;
+  p->vruntime = 0;
+  p->mlfq_level = 0;
+  p->sched_class = SCHED_NORMAL;
+  p->rt_prio = 0;
+  p->affinity = CPUMASK_ALL;
+  p->group = 0;
+  p->gang = 0;
+  p->gang_slice = 0;
+  p->rq = 0;
+  p->heap_index = -1;
 
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -176,7 +204,27 @@ freeproc(struct proc *p)
   p->cpu_burst = 0;
   p->timeslice = 0;
   p->put_timestamp = 0;
-  p->exe_time = 0;
+  p->run_start = 0;
+  p->run_time = 0;
+  p->wait_time = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->last_burst = 0;
+  p->last_burst_aprox = 0;
+  p->last_cpu = -1;
+  p->nr_migrations = 0;
+  p->nice = 0;
+  p->weight = NICE_0_WEIGHT;
+  p->vruntime = 0;
+  p->mlfq_level = 0;
+  p->sched_class = SCHED_NORMAL;
+  p->rt_prio = 0;
+  p->affinity = CPUMASK_ALL;
+  p->group = 0;
+  p->gang = 0;
+  p->gang_slice = 0;
+  p->rq = 0;
+  p->heap_index = -1;
 }
 
 // Create a user page table for a given process,
@@ -317,6 +365,16 @@ fork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  // the child starts from the parent's share, so forking
+  // does not buy extra cpu under cfs.
+  np->nice = p->nice;
+  np->vruntime = p->vruntime;
+  np->sched_class = p->sched_class;
+  np->rt_prio = p->rt_prio;
+  np->affinity = p->affinity;
+  np->group = p->group;
+  np->gang = p->gang;
+
   pid = np->pid;
 
   release(&np->lock);
@@ -458,6 +516,9 @@ scheduler(void)
   struct cpu *c = mycpu();
   
   c->proc = 0;
+  // from now on put() may hand processes to this cpu's run queue.
+  __sync_synchronize();
+  c->online = 1;
   for(;;) {
       // Avoid deadlock by ensuring that devices can interrupt.
       intr_on();
@@ -482,14 +543,26 @@ scheduler(void)
       */
 
       p = get();
-      if (p != 0) {
+      if (p == 0) {
+          idle(c);
+      } else {
+          if (p->gang != 0)
+              coschedule(p);
           acquire(&p->lock);
           if (p->state == RUNNABLE) {
+              uint64 now = sched_clock();
+              p->wait_time += now - p->put_timestamp;
+              p->run_start = now;
+
               p->state = RUNNING;
               c->proc = p;
+              c->need_resched = 0;
+              trace_sched(TR_SWITCH_IN, p, cpuid(), 0);
               swtch(&c->context, &p->context);
+              trace_sched(TR_SWITCH_OUT, p, cpuid(), p->state);
 
-              if (c->proc != 0 && c->proc->state == RUNNABLE) put(c->proc);
+              // a process that is RUNNABLE again was already
+              // re-queued by yield(), so it must not be put() twice.
               c->proc = 0;
           }
           release(&p->lock);
@@ -497,6 +570,30 @@ scheduler(void)
   }
 }
 
+// gang scheduling: p, taken by get(), is about to run on this cpu.
+// have its gang mates that are waiting start on other cpus now, with
+// the same timeslice, so that e.g. the stages of a pipeline run side
+// by side rather than each waiting for its turn. gang mates are found
+// by scanning the table, as wakeup() does.
+static void
+coschedule(struct proc *p)
+{
+  struct proc *m;
+  int gang = p->gang;
+
+  push_off();
+  int self = cpuid();
+  pop_off();
+  for(m = proc; m < &proc[NPROC]; m++){
+    if(m == p || m->gang != gang)
+      continue;
+    acquire(&m->lock);
+    if(m->gang == gang && m->state == RUNNABLE)
+      gang_place(m, self, p->timeslice);
+    release(&m->lock);
+  }
+}
+
 // Switch to sched_policy.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
@@ -519,6 +616,16 @@ sched(void)
   if(intr_get())
     panic("sched interruptible");
 
+  // yield() has already made p RUNNABLE, and put() has charged it
+  // before queueing it, maybe where another hart can take it now;
+  // sleep() and exit() have done neither.
+  if(p->state == RUNNABLE){
+    p->nivcsw++;
+  } else {
+    update_curr(p);
+    p->nvcsw++;
+  }
+
   intena = mycpu()->intena;
   swtch(&p->context, &mycpu()->context);
   mycpu()->intena = intena;
@@ -577,6 +684,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  trace_sched(TR_SLEEP, p, cpuid(), 0);
 
   sched();
 
@@ -623,6 +731,10 @@ kill(int pid)
         // Wake process from sleep().
         //p->state = RUNNABLE;
         put(p);
+      } else if(p->state == RUNNABLE){
+        // Let it exit and free its resources before
+        // the others it is queued with.
+        requeue_front(p);
       }
       release(&p->lock);
       return 0;
@@ -632,6 +744,199 @@ kill(int pid)
   return -1;
 }
 
+// Set the cfs nice value of the process with the given pid.
+int
+setnice(int pid, int nice)
+{
+  struct proc *p;
+
+  if(nice < NICE_MIN || nice > NICE_MAX)
+    return -1;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      p->nice = nice;
+      reweight(p, nice_to_weight(nice));
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Set the scheduling class of the process with the given pid:
+// SCHED_NORMAL, or SCHED_FIFO/SCHED_RR at real-time priority
+// prio (0 is the most urgent).
+int
+setsched(int pid, int cls, int prio)
+{
+  struct proc *p;
+
+  if(cls != SCHED_NORMAL && cls != SCHED_FIFO && cls != SCHED_RR)
+    return -1;
+  if(cls == SCHED_NORMAL)
+    prio = 0;
+  else if(prio < 0 || prio >= NRTPRIO)
+    return -1;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      setclass(p, cls, prio);
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Restrict the process with the given pid to the cpus in mask
+// (bit i for cpu i). At least one of them must be running.
+int
+setaffinity(int pid, uint64 mask)
+{
+  struct proc *p;
+  struct cpu *c;
+  uint64 online = 0;
+
+  for(c = cpus; c < &cpus[NCPU]; c++)
+    if(c->online)
+      online |= 1UL << (c - cpus);
+  if((mask & ~CPUMASK_ALL) != 0 || (mask & online) == 0)
+    return -1;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      set_cpus_allowed(p, mask);
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Put the process with the given pid in gang g (0 for none).
+// Gang mates are scheduled together, see coschedule(); children
+// start in the same gang.
+int
+setgang(int pid, int g)
+{
+  struct proc *p;
+
+  if(g < 0)
+    return -1;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      p->gang = g;
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Move the process with the given pid to CFS scheduling group g.
+// Its children start in the same group.
+int
+setgroup(int pid, int g)
+{
+  struct proc *p;
+
+  if(g < 0 || g >= NGROUP)
+    return -1;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      regroup(p, g);
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Copy the scheduler accounting of the process with the
+// given pid (0 for the caller) to struct cputime at addr.
+int
+getcputime(int pid, uint64 addr)
+{
+  struct proc *p;
+  struct cputime ct;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      if(p == myproc())
+        update_curr(p);
+      ct.run = p->run_time;
+      ct.wait = p->wait_time;
+      ct.burst = p->cpu_burst;
+      ct.burst_aprox = p->cpu_burst_aprox;
+      ct.vruntime = p->vruntime;
+      release(&p->lock);
+      return copyout(myproc()->pagetable, addr, (char *)&ct, sizeof(ct));
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Copy the scheduler statistics of the process with the smallest
+// pid >= pid to struct schedstat at addr. Returns that pid, so
+// callers can walk the process table, or -1 if there is none.
+int
+schedstat(int pid, uint64 addr)
+{
+  struct proc *p, *found = 0;
+  struct schedstat st;
+
+  // pids are not ordered in the table, so find the candidate first.
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->state != UNUSED && p->pid >= pid && (found == 0 || p->pid < found->pid))
+      found = p;
+    release(&p->lock);
+  }
+  if(found == 0)
+    return -1;
+
+  p = found;
+  acquire(&p->lock);
+  if(p->state == UNUSED || p->pid < pid){
+    // freed meanwhile; the caller will just miss it this round.
+    release(&p->lock);
+    return -1;
+  }
+  if(p == myproc())
+    update_curr(p);
+  st.pid = p->pid;
+  st.state = p->state;
+  st.nice = p->nice;
+  st.group = p->group;
+  safestrcpy(st.name, p->name, sizeof(st.name));
+  st.run = p->run_time;
+  st.wait = p->wait_time;
+  st.nvcsw = p->nvcsw;
+  st.nivcsw = p->nivcsw;
+  st.last_burst = p->last_burst;
+  st.last_burst_aprox = p->last_burst_aprox;
+  st.burst_aprox = p->cpu_burst_aprox;
+  st.cpu = p->last_cpu;
+  st.migrations = p->nr_migrations;
+  release(&p->lock);
+
+  if(copyout(myproc()->pagetable, addr, (char *)&st, sizeof(st)) < 0)
+    return -1;
+  return st.pid;
+}
+
 // Copy to either a user address, or kernel address,
 // depending on usr_dst.
 // Returns 0 on success, -1 on error.
@@ -691,174 +996,33 @@ procdump(void)
   }
 }
 
-///////////////////////////
-
-void heapify_up(struct proc** arr, int n, int algo)
-{
-    if (n == 1) return;
-    int curr = n - 1;
-    int parent = curr / 2;
-
-    while (1)
-    {
-        if ((algo == 0 && arr[curr]->cpu_burst_aprox < arr[parent]->cpu_burst_aprox) ||
-            (algo != 0 && arr[curr]->exe_time < arr[parent]->exe_time)) {
-            struct proc *tmp = arr[curr];
-            arr[curr] = arr[parent];
-            arr[parent] = tmp;
-        }
-        else break;
-        if (parent == 0) break;
-        curr = parent;
-        parent = (curr - 1) / 2;
-    }
-}
-
-void heapify_down(struct proc** arr, int n, int algo)
-{
-    heapify_down_i(arr,n,0,algo);
-}
-
-void heapify_down_i(struct proc** arr, int n, int i, int algo)
-{
-    if (n == 1) return;
-    int curr = i;
-    int left_child = curr * 2 + 1;
-    int right_child = curr * 2 + 2;
-
-    while(1)
-    {
-        if ((algo == 0 && left_child < n && arr[curr]->cpu_burst_aprox > arr[left_child]->cpu_burst_aprox) ||
-            (algo != 0 && left_child < n && arr[curr]->exe_time > arr[left_child]->exe_time))
-        {
-            struct proc* tmp = arr[curr];
-            arr[curr] = arr[left_child];
-            arr[left_child] = tmp;
-            curr = left_child;
-        }
-        else if ((algo == 0 && right_child < n && arr[curr]->cpu_burst_aprox > arr[right_child]->cpu_burst_aprox) ||
-                 (algo != 0 && right_child < n && arr[curr]->cpu_burst_aprox > arr[right_child]->cpu_burst_aprox))
-        {
-            struct proc* tmp = arr[curr];
-            arr[curr] = arr[right_child];
-            arr[right_child] = tmp;
-            curr = right_child;
-        }
-        else break;
-        left_child = curr * 2 + 1;
-        right_child = curr * 2 + 2;
-    }
-}
-
-void put(struct proc *p)
-{
-    if (p == 0) return;
-    int cpu_already_locked_the_lock = 1;
-    if(!holding(&p->lock)) // same cpu can't aquire the same lock twice
-    {
-        acquire(&p->lock);
-        cpu_already_locked_the_lock = 0;
-    }
-    acquire(&proc_sched.lock);
-    // critical section
-
-    // exponential averaging
-    if (proc->state != RUNNING)
-        p->cpu_burst_aprox = (proc_sched.a * p->cpu_burst + (100 - proc_sched.a) * p->cpu_burst_aprox) / 100;
-
-    if (p->state == RUNNING) p->exe_time += p->cpu_burst;
-    else p->exe_time = 0;  // when process is suspended or has never been executed on the cpu, exe_time should reset
-
-    p->put_timestamp = ticks;
-
-    p->state = RUNNABLE;
-
-    proc_sched.heap[proc_sched.heap_size] = p;
-    proc_sched.heap_size += 1;
-    heapify_up((struct proc**) &proc_sched.heap, proc_sched.heap_size, proc_sched.algorithm);
-
-    //printf("put | pid: %d | cpu_burst: %d\n", p->pid, p->cpu_burst);
-
-    // end of critical section
-    release(&proc_sched.lock);
-    if (!cpu_already_locked_the_lock)
-        release(&p->lock);
-}
-
-struct proc* get()
+// called from scheduler() when get() found nothing to run, with
+// interrupts on. rather than polling the run queues, park the hart
+// in wfi until an interrupt arrives: put() sends an ipi to an idle
+// cpu it hands a process to. harts other than 0 also stop their
+// periodic timer while parked, since they have nothing to preempt;
+// hart 0 keeps it running to maintain ticks. before parking, the
+// hart zeroes free pages for kalloc_zeroed(), a batch at a time,
+// going back to look for work after each batch.
+static void idle(struct cpu *c)
 {
-    struct proc* ret = 0;
-    acquire(&proc_sched.lock);
-
-    if (proc_sched.heap_size == 0) goto exit_get;
-    ret = proc_sched.heap[0];
-    ret->cpu_burst = 0;
-    proc_sched.heap[0] = proc_sched.heap[proc_sched.heap_size - 1];
-    proc_sched.heap[proc_sched.heap_size - 1] = 0;
-    proc_sched.heap_size -= 1;
-    heapify_down((struct proc**) &proc_sched.heap, proc_sched.heap_size, proc_sched.algorithm);
-
-    if (proc_sched.algorithm == 1) {
-        int cfs_timeslice = (ticks - ret->put_timestamp) / (proc_sched.heap_size + 1); // +1 for zero-division prevention
-        if (cfs_timeslice == 0) cfs_timeslice++;
-        ret->timeslice = cfs_timeslice;
+    if (kzero_fill() > 0)
+        return;
+
+    intr_off();
+    c->idle = 1;
+    __sync_synchronize();
+
+    // look once more with interrupts off. if put() queues something
+    // after this check, it sees c->idle and its ipi stays pending,
+    // so wfi returns at once instead of missing the wakeup.
+    if (!cpu_has_work(c)) {
+        if (cpuid() != 0) timer_stop();
+        wfi();
+        if (cpuid() != 0) timer_start();
     }
 
-    exit_get:    release(&proc_sched.lock);
-    return ret;
+    c->idle = 0;
+    __sync_synchronize();
+    intr_on();
 }
-
-//////////////////
-
-void rearrange_heap(struct proc** arr, int n, int algo)
-{
-    int i_init = n / 2 - 1; // index of last non-leaf element
-
-    for (int i = i_init; i >= 0; i--)
-        heapify_down_i(arr, n, i, algo);
-}
-
-/*
-// when changing the process scheduling policy, we must sort the heap by different criteria
-int change_sched(int algo, int is_preemptive, int a){
-    acquire(&proc_sched.lock);
-
-    int new_algo = (proc_sched.algorithm == 0 ? 1 : 0);
-    proc_sched.algorithm = new_algo;
-
-    rearrange_heap((struct proc **) &proc_sched.heap, proc_sched.heap_size, new_algo);
-
-    release(&proc_sched.lock);
-    return new_algo;
-}
- */
-
-int change_sched(int algo, int is_preemptive, int a){
-    if (algo < 0 || algo > 1 || is_preemptive<0) return -2;
-    if (algo == 0 && (a<0 || a>100)) return -3;
-    acquire(&proc_sched.lock);
-
-    proc_sched.algorithm = algo;
-    proc_sched.is_preemptive = is_preemptive;
-    proc_sched.a = a;
-
-    rearrange_heap((struct proc **) &proc_sched.heap, proc_sched.heap_size, algo);
-
-    release(&proc_sched.lock);
-    return 0;
-}
-
-//////////////////////////
-
-// timer interrupt routine called from trap.c
-void timer_routine(struct proc* p)
-{
-    p->cpu_burst += 1;
-
-    //printf("timer | pid: %d | cpu_burst: %d\n", myproc()->pid, myproc()->cpu_burst);
-
-    if ((p->timeslice != 0 && p->cpu_burst == p->timeslice) ||
-        (proc_sched.algorithm == 0 && proc_sched.is_preemptive==1))
-        yield();
-}
-
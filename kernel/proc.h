@@ -18,13 +18,56 @@ struct context {
   uint64 s11;
 };
 
+// fifo lists of processes by priority, 0 first, see prioq.c.
+struct prioq {
+  struct proc *head[NPRIOQ];
+  struct proc *tail[NPRIOQ];
+  uint bitmap;                // bit i set if list i is not empty
+};
+
+// one scheduling group's processes in a cpu's CFS queue, see cfs.c.
+struct cfs_rq {
+  struct proc *root;
+  struct proc *leftmost;      // smallest vruntime in the tree
+  int load;                   // sum of the weights in the tree
+  int nr;                     // processes in the tree
+  uint64 min_vruntime;        // monotonic floor for woken processes
+  uint64 vruntime;            // the group's own, weighted by its shares
+  uint64 charge;              // run time for vruntime, see cfs_fold()
+};
+
+// Per-CPU run queue of RUNNABLE processes. Real-time processes wait
+// in rt, ahead of everything; a gang member handed over to run next
+// waits in next. The rest wait in the structure of the current
+// algorithm: a binary heap ordered by cpu_burst_aprox under SJF, a
+// red-black tree per scheduling group ordered by vruntime under CFS
+// (see cfs.c), or one fifo list per level under MLFQ (see mlfq.c).
+struct runqueue {
+  struct spinlock lock;
+  int nr;                     // processes waiting, in any of the below
+  int nr_pinned;              // of those, allowed on a single cpu only
+  struct proc *next;          // gang member handed to this cpu to run next, or 0
+  struct prioq rt;            // real-time class, ahead of everything else
+  struct proc *heap[NPROC];
+  int heap_size;
+  struct cfs_rq cfs[NGROUP];  // per scheduling group
+  uint64 group_min_vruntime;  // monotonic floor for groups starting to wait
+  struct prioq mlfq;          // one list per MLFQ level
+  uint64 mlfq_boosted;        // when the levels were last flattened
+};
+
 // Per-CPU state.
 struct cpu {
   struct proc *proc;          // The process running on this cpu, or null.
   struct context context;     // swtch() here to enter sched_policy().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
-};
+  int online;                 // Has this cpu entered scheduler()?
+  int idle;                   // Parked in wfi with nothing to run?
+  int need_resched;           // Set by put() before a reschedule ipi.
+  int balance_ticks;          // Timer interrupts since the last rebalance.
+  struct runqueue rq;         // Processes waiting to run on this cpu.
+} __attribute__ ((aligned (64)));
 
 extern struct cpu cpus[NCPU];
 
@@ -93,11 +136,46 @@ struct proc {
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
 
-  int cpu_burst_aprox;
-  int cpu_burst;
-  int timeslice;
-  int put_timestamp;
-  int exe_time;
+  // scheduler accounting, in nanoseconds of sched_clock().
+  uint64 cpu_burst_aprox;      // SJF prediction of the next burst
+  uint64 sjf_key;              // SJF heap key, see rq_push()
+  uint64 cpu_burst;            // time run since last dispatched
+  uint64 timeslice;            // CFS time to run before preemption, or 0
+  uint64 put_timestamp;        // when last put in a run queue
+  uint64 run_start;            // when running time was last charged
+  uint64 run_time;             // total time on a cpu
+  uint64 wait_time;            // total time waiting in a run queue
+  uint64 nvcsw;                // voluntary switches: sleep, exit
+  uint64 nivcsw;               // involuntary switches: preemption
+  uint64 last_burst;           // length of the last finished burst
+  uint64 last_burst_aprox;     // its SJF prediction
+  int last_cpu;                // cpu p last ran on, or -1
+  uint64 nr_migrations;        // dispatches on a cpu other than last_cpu
+  struct runqueue *rq;         // Run queue p is waiting in, or 0
+  int heap_index;              // Position in rq->heap under SJF, or -1
+
+  // CFS state, see cfs.c.
+  int nice;                    // NICE_MIN..NICE_MAX
+  int weight;                  // nice_to_weight(nice)
+  uint64 vruntime;             // weighted run time, ns
+  struct proc *rb_parent;      // run queue tree links
+  struct proc *rb_left;
+  struct proc *rb_right;
+  int rb_red;
+
+  // MLFQ state, see mlfq.c.
+  int mlfq_level;              // 0 (highest) .. MLFQ_LEVELS-1
+
+  // scheduling class: SCHED_NORMAL follows proc_sched.algorithm,
+  // SCHED_FIFO and SCHED_RR run first, by rt_prio.
+  int sched_class;
+  int rt_prio;                 // 0 (highest) .. NRTPRIO-1
+  struct proc *q_next;         // prioq list links (MLFQ level or rt_prio)
+  struct proc *q_prev;
+  uint64 affinity;             // bit i set if p may run on cpu i
+  int group;                   // CFS scheduling group, 0..NGROUP-1
+  int gang;                    // gang id, 0 for none, see coschedule()
+  uint64 gang_slice;           // timeslice handed down by a gang mate, or 0
 
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
@@ -115,11 +193,37 @@ struct proc {
 
 // shortest-job-first process sched_policy with exponential averaging - 0
 // completely-fair process sched_policy - 1
+// the runnable processes themselves live in the per-CPU run queues;
+// these parameters only change while every cpus[i].rq.lock is held,
+// so holding any one run queue lock is enough to read them.
 struct sched_policy {
-    struct proc* heap[NPROC];
-    int heap_size;
-    struct spinlock lock;
+    struct spinlock lock;      // serializes change_sched()
     int a;                     // in %
-    int algorithm;             // =0 for sjf and !=0 for cfs (initially 0)
+    int algorithm;             // 0 sjf, 1 cfs, 2 mlfq (initially 0)
     int is_preemptive;         // applies only on sjf algorithm
+    int aging;                 // sjf: % of the time waited taken off the prediction
+    uint64 sched_latency;      // cfs: ns in which every waiting process should run once
+    uint64 quantum[NSCHED];    // per algorithm: ns a process runs before it may be preempted
+                               // (preemptive sjf: between checks; cfs: minimum granularity;
+                               // mlfq: at level 0, doubling with each level)
+    uint64 mlfq_boost;         // mlfq: ns between moving everything back to level 0
+    uint64 rr_quantum;         // ns a SCHED_RR process runs before yielding to its peers
+    uint64 cache_tolerance;    // ns of key a process that last ran on the picking cpu may
+                               // trail the best by and still go first, see rq_pop_warm()
 };
+
+extern struct sched_policy proc_sched;
+
+// a CFS scheduling group, see setgroup() and groupctl().
+// shares, quota and period change only under lock_policy(); used and
+// throttled are updated without locks by the cpus charging run time.
+struct schedgroup {
+    int shares;                // cpu weight against other groups, NICE_0_WEIGHT by default
+    uint64 quota;              // ns the group may run per period, on all cpus; 0 for no limit
+    uint64 period;             // ns
+    uint64 period_start;       // when the current period began
+    uint64 used;               // ns run in the current period
+    int throttled;             // quota used up: its processes wait for the next period
+};
+
+extern struct schedgroup sched_groups[NGROUP];
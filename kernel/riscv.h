@@ -323,6 +323,15 @@ r_ra()
   return x;
 }
 
+// stall this hart until an interrupt is pending. this happens
+// even if sstatus.SIE is off, as long as the interrupt is
+// enabled in sie.
+static inline void
+wfi()
+{
+  asm volatile("wfi");
+}
+
 // flush the TLB.
 static inline void
 sfence_vma()
@@ -343,6 +352,7 @@ sfence_vma()
 #define PTE_W (1L << 2)
 #define PTE_X (1L << 3)
 #define PTE_U (1L << 4) // 1 -> user can access
+#define PTE_COW (1L << 8) // reserved for software: shared copy-on-write
 
 // shift a physical address to the right place for a PTE.
 #define PA2PTE(pa) ((((uint64)pa) >> 12) << 10)
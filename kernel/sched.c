@@ -0,0 +1,1193 @@
+// Run queues and scheduling policy: where put() queues a process,
+// which process get() hands to scheduler(), and when timer_routine()
+// preempts the running one. SJF keeps each cpu's queue in an indexed
+// heap ordered by predicted burst, CFS in the red-black tree of cfs.c,
+// MLFQ in per-level lists (mlfq.c). Real-time processes (SCHED_FIFO,
+// SCHED_RR) wait in a separate list per priority and always go first.
+//
+// Besides the kernel, sim/schedsim links this file against stubs for
+// locks, cpus and the clock, so keep hardware access out of it.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "schedtrace.h"
+#include "defs.h"
+
+// initial scheduling policy is shortest-job-first
+struct sched_policy proc_sched = { .a = 50, .algorithm = 0, .is_preemptive = 0,
+                                   .sched_latency = 8 * TICK_USEC * 1000UL,
+                                   .quantum = { TICK_USEC * 1000UL, TICK_USEC * 1000UL, TICK_USEC * 1000UL },
+                                   .mlfq_boost = 32 * TICK_USEC * 1000UL,
+                                   .rr_quantum = TICK_USEC * 1000UL,
+                                   .cache_tolerance = TICK_USEC * 100UL };
+
+struct schedgroup sched_groups[NGROUP];
+
+// every group starts with a nice 0 process's weight and no quota.
+void groupinit(void)
+{
+    for (struct schedgroup *g = sched_groups; g < &sched_groups[NGROUP]; g++) {
+        g->shares = NICE_0_WEIGHT;
+        g->quota = 0;
+        g->period = 10 * TICK_USEC * 1000UL;
+        g->period_start = 0;
+        g->used = 0;
+        g->throttled = 0;
+    }
+}
+
+// true if a should be closer to the top of the heap than b
+static int heap_before(struct proc* a, struct proc* b, int algo)
+{
+    if (algo == 0) return a->sjf_key < b->sjf_key;
+    return vruntime_before(a->vruntime, b->vruntime);
+}
+
+// every process in a heap knows its own index, so it can be found
+// and moved without scanning. all heap moves go through here.
+static void heap_swap(struct proc** arr, int i, int j)
+{
+    struct proc *tmp = arr[i];
+    arr[i] = arr[j];
+    arr[j] = tmp;
+    arr[i]->heap_index = i;
+    arr[j]->heap_index = j;
+}
+
+// arr[n-1] was just appended: move it up to its place
+void heapify_up(struct proc** arr, int n, int algo)
+{
+    if (n <= 1) return;
+    heap_decrease_key(arr, n - 1, algo);
+}
+
+// sift arr[i] down to its place in a heap of n elements
+void heapify_down_i(struct proc** arr, int n, int i, int algo)
+{
+    int curr = i;
+
+    while(1)
+    {
+        int left_child = curr * 2 + 1;
+        int right_child = curr * 2 + 2;
+        int smallest = curr;
+
+        if (left_child < n && heap_before(arr[left_child], arr[smallest], algo))
+            smallest = left_child;
+        if (right_child < n && heap_before(arr[right_child], arr[smallest], algo))
+            smallest = right_child;
+        if (smallest == curr) break;
+
+        heap_swap(arr, curr, smallest);
+        curr = smallest;
+    }
+}
+
+// the key of arr[i] got smaller (better): move it up. O(log n)
+void heap_decrease_key(struct proc** arr, int i, int algo)
+{
+    int curr = i;
+
+    while (curr > 0)
+    {
+        int parent = (curr - 1) / 2;
+        if (!heap_before(arr[curr], arr[parent], algo)) break;
+        heap_swap(arr, curr, parent);
+        curr = parent;
+    }
+}
+
+// the key of arr[i] got larger (worse): move it down. O(log n)
+void heap_increase_key(struct proc** arr, int n, int i, int algo)
+{
+    heapify_down_i(arr, n, i, algo);
+}
+
+// remove and return arr[i] from a heap of *n elements. O(log n)
+struct proc* heap_remove(struct proc** arr, int *n, int i, int algo)
+{
+    struct proc *p = arr[i];
+    int last = *n - 1;
+
+    if (i != last) {
+        heap_swap(arr, i, last);
+        struct proc *moved = arr[i];
+        arr[last] = 0;
+        *n = last;
+        // the element moved into i may belong above or below it
+        heap_decrease_key(arr, i, algo);
+        heap_increase_key(arr, *n, moved->heap_index, algo);
+    } else {
+        arr[last] = 0;
+        *n = last;
+    }
+    p->heap_index = -1;
+    return p;
+}
+
+// may p run on c?
+static int cpu_allowed(struct proc *p, struct cpu *c)
+{
+    return (p->affinity >> (c - cpus)) & 1;
+}
+
+// is p allowed on a single cpu only?
+static int pinned(struct proc *p)
+{
+    return (p->affinity & (p->affinity - 1)) == 0;
+}
+
+// preemptive sjf: the cpu running the process with the most predicted
+// time left, if that is more than p's whole predicted burst, or 0.
+// c->proc and its accounting are read without locks: a stale answer
+// costs one needless or one missed preemption, nothing more.
+static struct cpu* sjf_preempt_target(struct proc *p)
+{
+    uint64 now = sched_clock();
+    uint64 most = p->cpu_burst_aprox;
+    struct cpu *victim = 0;
+
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        struct proc *r = c->proc;
+        if (!c->online || !cpu_allowed(p, c) || r == 0 || r == p || r->sched_class != SCHED_NORMAL) continue;
+        uint64 ran = r->cpu_burst + (now - r->run_start);
+        uint64 left = (r->cpu_burst_aprox > ran ? r->cpu_burst_aprox - ran : 0);
+        if (left > most) {
+            most = left;
+            victim = c;
+        }
+    }
+    return victim;
+}
+
+// real-time p is waking up: the cpu running the least urgent process
+// p would preempt (a normal one, or else a real-time one of a lower
+// priority), or 0. read without locks, as in sjf_preempt_target().
+static struct cpu* rt_preempt_target(struct proc *p)
+{
+    struct cpu *victim = 0;
+    int worst = p->rt_prio;
+
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        struct proc *r = c->proc;
+        if (!c->online || !cpu_allowed(p, c) || r == 0 || r == p) continue;
+        // a normal process ranks below every real-time priority
+        int prio = (r->sched_class == SCHED_NORMAL ? NRTPRIO : r->rt_prio);
+        if (prio > worst) {
+            worst = prio;
+            victim = c;
+        }
+    }
+    return victim;
+}
+
+// p is waking up and belongs to a gang: if a gang mate is running,
+// an allowed cpu running a normal process from outside the gang, that
+// p should take over at once so the gang runs together. or 0. read
+// without locks, as in sjf_preempt_target().
+static struct cpu* gang_preempt_target(struct proc *p)
+{
+    struct cpu *victim = 0;
+    int active = 0;
+
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        struct proc *r = c->proc;
+        if (!c->online || r == 0 || r == p) continue;
+        if (r->gang == p->gang) {
+            active = 1;
+        } else if (victim == 0 && cpu_allowed(p, c) && r->sched_class == SCHED_NORMAL &&
+                   c->rq.next == 0) {
+            victim = c;
+        }
+    }
+    return (active ? victim : 0);
+}
+
+// Choose the cpu whose run queue p should wait in:
+//  - the calling cpu, if p is giving it up and nothing else waits there;
+//  - otherwise an idle cpu, which will run p right away, preferably
+//    the one p last ran on;
+//  - if p is waking up and real-time, a cpu running something less
+//    urgent; under preemptive sjf, the cpu whose running process has
+//    the most predicted time left beyond p's burst. *preempt is then
+//    set and that cpu should reschedule at once. a gang member whose
+//    gang is running takes over a cpu running something else: *preempt
+//    is 2, and p should be handed to that cpu as rq->next;
+//  - otherwise the calling cpu while it has nothing waiting,
+//  - otherwise the cpu with the shortest queue, p's last cpu on a tie.
+// Only cpus in p->affinity that have entered scheduler() are
+// considered. Before any of them is online (userinit) the caller's
+// queue is used.
+// Interrupts must be disabled.
+static struct cpu* pick_cpu(struct proc *p, int *preempt)
+{
+    struct cpu *self = mycpu();
+    struct cpu *best = 0;
+    struct cpu *c;
+
+    *preempt = 0;
+    if (self->proc == p && self->rq.nr == 0 && cpu_allowed(p, self)) return self;
+
+    // an idle cpu, the one p last ran on if it is
+    if (p->last_cpu >= 0) {
+        c = &cpus[p->last_cpu];
+        if (c->online && c->idle && c->rq.nr == 0 && cpu_allowed(p, c))
+            return c;
+    }
+    for (c = cpus; c < &cpus[NCPU]; c++) {
+        if (c->online && c->idle && c->rq.nr == 0 && cpu_allowed(p, c))
+            return c;
+    }
+
+    if (p->state != RUNNING) {
+        if (p->sched_class == SCHED_NORMAL && p->gang != 0 &&
+            (c = gang_preempt_target(p)) != 0) {
+            *preempt = 2;
+            return c;
+        }
+        if (p->sched_class != SCHED_NORMAL)
+            c = rt_preempt_target(p);
+        else if (proc_sched.algorithm == 0 && proc_sched.is_preemptive == 1)
+            c = sjf_preempt_target(p);
+        else
+            c = 0;
+        if (c != 0) {
+            *preempt = 1;
+            return c;
+        }
+    }
+
+    if (self->rq.nr == 0 && cpu_allowed(p, self)) return self;
+
+    for (c = cpus; c < &cpus[NCPU]; c++) {
+        if (!c->online || !cpu_allowed(p, c)) continue;
+        if (best == 0 || c->rq.nr < best->rq.nr ||
+            (c->rq.nr == best->rq.nr && c - cpus == p->last_cpu))
+            best = c;
+    }
+    return (best != 0 ? best : self);
+}
+
+// sjf orders by the prediction minus aging% of the time waited so far,
+//   cpu_burst_aprox - aging * (now - put_timestamp) / 100,
+// so a long job that keeps being passed over eventually comes first.
+// now is the same for every process in a heap, so the order is that of
+// cpu_burst_aprox + aging * put_timestamp / 100: a key that does not
+// change while p waits, and the heap never needs re-sorting as it ages.
+static uint64 sjf_key(struct proc *p)
+{
+    return p->cpu_burst_aprox + proc_sched.aging * p->put_timestamp / 100;
+}
+
+// what the aged key of waiting process p amounts to now.
+static uint64 sjf_aged(struct proc *p, uint64 now)
+{
+    uint64 credit = proc_sched.aging * (now - p->put_timestamp) / 100;
+    return (p->cpu_burst_aprox > credit ? p->cpu_burst_aprox - credit : 0);
+}
+
+// insert p into rq's real-time lists, or its heap (SJF), tree (CFS)
+// or level lists (MLFQ). rq->lock must be held.
+static void rq_push(struct runqueue *rq, struct proc *p)
+{
+    if (p->sched_class != SCHED_NORMAL) {
+        prioq_push(&rq->rt, p, p->rt_prio);
+    } else if (proc_sched.algorithm == 0) {
+        p->sjf_key = sjf_key(p);
+        rq->heap[rq->heap_size] = p;
+        p->heap_index = rq->heap_size;
+        rq->heap_size += 1;
+        heapify_up((struct proc**) &rq->heap, rq->heap_size, proc_sched.algorithm);
+    } else if (proc_sched.algorithm == 1) {
+        cfs_enqueue(rq, p);
+    } else {
+        prioq_push(&rq->mlfq, p, p->mlfq_level);
+    }
+    p->rq = rq;
+    rq->nr += 1;
+    if (pinned(p)) rq->nr_pinned += 1;
+}
+
+// hand p to rq's cpu to run next, ahead of whatever waits in rq.
+// rq->next must be free. rq->lock must be held.
+static void rq_push_next(struct runqueue *rq, struct proc *p)
+{
+    rq->next = p;
+    p->rq = rq;
+    rq->nr += 1;
+    if (pinned(p)) rq->nr_pinned += 1;
+}
+
+// take p, which is waiting in rq, out of it. rq->lock must be held.
+static void rq_remove(struct runqueue *rq, struct proc *p)
+{
+    if (rq->next == p)
+        rq->next = 0;
+    else if (p->sched_class != SCHED_NORMAL)
+        prioq_remove(&rq->rt, p, p->rt_prio);
+    else if (proc_sched.algorithm == 0)
+        heap_remove((struct proc**) &rq->heap, &rq->heap_size, p->heap_index, proc_sched.algorithm);
+    else if (proc_sched.algorithm == 1)
+        cfs_dequeue(rq, p);
+    else
+        prioq_remove(&rq->mlfq, p, p->mlfq_level);
+    p->rq = 0;
+    rq->nr -= 1;
+    if (pinned(p)) rq->nr_pinned -= 1;
+}
+
+// the best process in rq, or 0 if it is empty. rq->lock must be held.
+static struct proc* rq_first(struct runqueue *rq)
+{
+    if (rq->nr == 0) return 0;
+    if (rq->rt.bitmap != 0) return prioq_first(&rq->rt);
+    if (rq->next != 0) return rq->next;
+    if (proc_sched.algorithm == 0) return rq->heap[0];
+    if (proc_sched.algorithm == 1) return cfs_pick(rq);
+    return prioq_first(&rq->mlfq);
+}
+
+// remove and return the best process in rq, or 0 if it is empty.
+// rq->lock must be held.
+static struct proc* rq_pop(struct runqueue *rq)
+{
+    struct proc *p = rq_first(rq);
+
+    if (p == 0) return 0;
+    if (proc_sched.algorithm == 1 && p->sched_class == SCHED_NORMAL && p != rq->next)
+        cfs_update_min_vruntime(rq, p);
+    rq_remove(rq, p);
+    return p;
+}
+
+// the process that would follow first, the best process in rq, if it
+// is good enough to go in its place: next in the same mlfq level, or
+// within proc_sched.cache_tolerance of first's key under sjf and cfs.
+// real-time processes keep their strict order.
+static struct proc* rq_runner_up(struct runqueue *rq, struct proc *first)
+{
+    uint64 tol = proc_sched.cache_tolerance;
+    struct proc *q = 0;
+
+    if (first->sched_class != SCHED_NORMAL)
+        return 0;
+    if (proc_sched.algorithm == 2)
+        return first->q_next;
+    if (proc_sched.algorithm == 1) {
+        q = cfs_next(first);
+        return (q != 0 && q->vruntime - first->vruntime <= tol ? q : 0);
+    }
+    // the second best of a heap is one of the root's children
+    for (int i = 1; i <= 2 && i < rq->heap_size; i++) {
+        if (q == 0 || heap_before(rq->heap[i], q, 0))
+            q = rq->heap[i];
+    }
+    return (q != 0 && q->sjf_key - first->sjf_key <= tol ? q : 0);
+}
+
+// like rq_pop(), for the cpu c that owns rq, but preferring what is
+// still warm in c's caches and TLB: if the best process last ran
+// elsewhere and the runner-up last ran on c, take the runner-up. the
+// best one is only passed over while it has waited less than
+// proc_sched.cache_tolerance, so it cannot starve.
+static struct proc* rq_pop_warm(struct runqueue *rq, struct cpu *c)
+{
+    struct proc *p = rq_first(rq);
+    struct proc *q;
+    int self = c - cpus;
+
+    if (p == 0 || p == rq->next || p->last_cpu == self || p->last_cpu < 0 ||
+        proc_sched.cache_tolerance == 0)
+        return rq_pop(rq);
+    if (sched_clock() - p->put_timestamp >= proc_sched.cache_tolerance)
+        return rq_pop(rq);
+    if ((q = rq_runner_up(rq, p)) == 0 || q->last_cpu != self)
+        return rq_pop(rq);
+
+    if (proc_sched.algorithm == 1)
+        cfs_update_min_vruntime(rq, p);
+    rq_remove(rq, q);
+    return q;
+}
+
+// the first process in q allowed to run on c, or 0.
+static struct proc* prioq_first_allowed(struct prioq *q, struct cpu *c)
+{
+    for (int i = 0; i < NPRIOQ; i++) {
+        for (struct proc *p = q->head[i]; p != 0; p = p->q_next)
+            if (cpu_allowed(p, c)) return p;
+    }
+    return 0;
+}
+
+// the best process in rq allowed to run on c, or 0. when that is the
+// best one overall it costs no more than rq_first(); otherwise rq is
+// searched in order. rq->lock must be held.
+static struct proc* rq_first_allowed(struct runqueue *rq, struct cpu *c)
+{
+    struct proc *p = rq_first(rq);
+
+    if (p == 0 || cpu_allowed(p, c)) return p;
+    // pinned processes wait on the one cpu they are pinned to, not c
+    if (rq->nr == rq->nr_pinned) return 0;
+
+    p = prioq_first_allowed(&rq->rt, c);
+    if (p == 0 && proc_sched.algorithm == 0) {
+        for (int i = 0; i < rq->heap_size; i++) {
+            struct proc *q = rq->heap[i];
+            if (cpu_allowed(q, c) && (p == 0 || heap_before(q, p, 0)))
+                p = q;
+        }
+    } else if (p == 0 && proc_sched.algorithm == 1) {
+        // the first allowed process of each group; the group furthest behind wins
+        cfs_fold(rq);
+        for (int g = 0; g < NGROUP; g++) {
+            struct proc *q = rq->cfs[g].leftmost;
+            if (sched_groups[g].throttled) continue;
+            while (q != 0 && !cpu_allowed(q, c))
+                q = cfs_next(q);
+            if (q != 0 && (p == 0 || vruntime_before(rq->cfs[g].vruntime, rq->cfs[p->group].vruntime)))
+                p = q;
+        }
+    } else if (p == 0) {
+        p = prioq_first_allowed(&rq->mlfq, c);
+    }
+    return p;
+}
+
+// like rq_pop(), for moving a process from rq, another cpu's queue,
+// to c: the best process allowed to run on c, or 0. rq->lock must be
+// held.
+static struct proc* rq_pop_allowed(struct runqueue *rq, struct cpu *c)
+{
+    struct proc *p = rq_first(rq);
+
+    if (p == 0 || cpu_allowed(p, c)) return rq_pop(rq);
+    if ((p = rq_first_allowed(rq, c)) != 0) rq_remove(rq, p);
+    return p;
+}
+
+// lock and return the run queue p is waiting in, or return 0 if p is
+// not queued. p->rq can change under us (get() and steal() do not hold
+// p->lock), so check it again once the queue's lock is held.
+// p->lock must be held.
+static struct runqueue* lock_queued(struct proc *p)
+{
+    struct runqueue *rq;
+
+    while ((rq = p->rq) != 0) {
+        acquire(&rq->lock);
+        if (p->rq == rq) return rq;
+        release(&rq->lock);
+    }
+    return 0;
+}
+
+// p was taken off from's run queue to run on or wait in to's.
+// vruntime only means something relative to its group's min_vruntime
+// in a queue, so carry the offset over rather than the absolute value.
+static void rq_migrate(struct runqueue *from, struct runqueue *to, struct proc *p)
+{
+    p->vruntime = p->vruntime - from->cfs[p->group].min_vruntime + to->cfs[p->group].min_vruntime;
+}
+
+// the online cpu other than self with the most processes waiting
+// that are not pinned to it, or 0 if no other cpu has any.
+// reads nr without locks, so the answer is only a hint.
+static struct cpu* busiest_cpu(struct cpu *self)
+{
+    struct cpu *busiest = 0;
+    int most = 0;
+
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        int movable = c->rq.nr - c->rq.nr_pinned;
+        if (c != self && c->online && movable > most) {
+            busiest = c;
+            most = movable;
+        }
+    }
+    return busiest;
+}
+
+// called by a cpu whose own run queue is empty: take the best waiting
+// process (shortest cpu_burst_aprox under SJF, smallest vruntime under
+// CFS) allowed to run here from the busiest other run queue.
+// could self take a process waiting in another cpu's queue? unlike
+// busiest_cpu() this looks past processes self may not run, such as
+// those allowed on several cpus but not on self, so idle() can park
+// instead of spinning on them. takes each candidate queue's lock.
+int can_steal(struct cpu *self)
+{
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        if (c == self || !c->online || c->rq.nr == c->rq.nr_pinned) continue;
+        acquire(&c->rq.lock);
+        int found = (rq_first_allowed(&c->rq, self) != 0);
+        release(&c->rq.lock);
+        if (found) return 1;
+    }
+    return 0;
+}
+
+static struct proc* steal(struct cpu *self)
+{
+    struct cpu *victim = busiest_cpu(self);
+    if (victim == 0) return 0;
+
+    acquire(&victim->rq.lock);
+    struct proc *p = rq_pop_allowed(&victim->rq, self); // may have been emptied meanwhile
+    if (p != 0) rq_migrate(&victim->rq, &self->rq, p);
+    release(&victim->rq.lock);
+    if (p != 0) trace_sched(TR_MIGRATE, p, self - cpus, victim - cpus);
+    return p;
+}
+
+// a process was just queued on target: have target reschedule at once
+// if preempt is set, else wake it if it is parked in idle().
+static void kick(struct cpu *target, int preempt)
+{
+    // pairs with the fence in idle(): either the target sees p in its
+    // queue before parking, or we see it parked and wake it up.
+    __sync_synchronize();
+    if (preempt) {
+        // p waits where it should run next; have that cpu reschedule
+        // now rather than at its next tick. the ipi is taken by this
+        // hart too, once interrupts are back on, if it is the target.
+        target->need_resched = 1;
+        send_ipi(target - cpus);
+    } else if (target != mycpu() && target->idle) {
+        send_ipi(target - cpus);
+    }
+}
+
+void put(struct proc *p)
+{
+    if (p == 0) return;
+    int cpu_already_locked_the_lock = 1;
+    if(!holding(&p->lock)) // same cpu can't aquire the same lock twice
+    {
+        acquire(&p->lock);
+        cpu_already_locked_the_lock = 0;
+    }
+    // exponential averaging. done before pick_cpu(), which weighs the
+    // new prediction; p->lock keeps it private, and a policy change
+    // racing with it only skews one prediction.
+    if (p->state != RUNNING) {
+        p->last_burst = p->cpu_burst;
+        p->last_burst_aprox = p->cpu_burst_aprox;
+        p->cpu_burst_aprox = (proc_sched.a * p->cpu_burst + (100 - proc_sched.a) * p->cpu_burst_aprox) / 100;
+    }
+
+    int preempt;
+    struct cpu *target = pick_cpu(p, &preempt);
+    struct runqueue *rq = &target->rq;
+    acquire(&rq->lock);
+    // critical section
+
+    if (p->state == RUNNING)
+        update_curr(p); // preempted: its vruntime key must be current
+
+    // p's vruntime is relative to the queue of the cpu it last ran on;
+    // keep its offset from min_vruntime on the new one. that cpu's
+    // min_vruntime is read without its lock, but it only moves forward.
+    if (p->last_cpu >= 0 && p->last_cpu != target - cpus)
+        rq_migrate(&cpus[p->last_cpu].rq, rq, p);
+
+    // a new nice value takes effect from the next time p is queued
+    p->weight = nice_to_weight(p->nice);
+    if (p->state != RUNNING)
+        cfs_place(rq, p);
+
+    // mlfq feedback: down a level for using up the quantum, up one for
+    // sleeping before that. a process preempted by a higher level keeps
+    // its own.
+    if (proc_sched.algorithm == 2) {
+        if (p->state == RUNNING && p->timeslice != 0 && p->cpu_burst >= p->timeslice) {
+            if (p->mlfq_level < MLFQ_LEVELS - 1) p->mlfq_level++;
+        } else if (p->state == SLEEPING) {
+            if (p->mlfq_level > 0) p->mlfq_level--;
+        }
+    }
+
+    p->put_timestamp = sched_clock();
+
+    if (p->state == SLEEPING)
+        trace_sched(TR_WAKEUP, p, target - cpus, 0);
+    p->state = RUNNABLE;
+
+    if (preempt == 2 && rq->next == 0)
+        rq_push_next(rq, p);
+    else
+        rq_push(rq, p);
+    trace_sched(TR_ENQUEUE, p, target - cpus, 0);
+
+    //printf("put | pid: %d | cpu_burst: %d\n", p->pid, p->cpu_burst);
+
+    // end of critical section
+    release(&rq->lock);
+
+    kick(target, preempt);
+
+    if (!cpu_already_locked_the_lock)
+        release(&p->lock);
+}
+
+// start a new period for each group with a quota whose period is
+// over, lifting its throttle. the cpu that swaps period_start does it,
+// and wakes the cpus parked in idle() with processes waiting, which
+// may be the group's. hart 0 never stops its timer, so this runs at
+// least once a tick.
+static void refresh_groups(uint64 now)
+{
+    int lifted = 0;
+
+    for (struct schedgroup *g = sched_groups; g < &sched_groups[NGROUP]; g++) {
+        uint64 start = g->period_start;
+        if (g->quota == 0 || now - start < g->period) continue;
+        if (__sync_bool_compare_and_swap(&g->period_start, start, now)) {
+            lifted |= g->throttled;
+            g->used = 0;
+            g->throttled = 0;
+        }
+    }
+    if (lifted) {
+        __sync_synchronize();
+        for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+            if (c->idle && c->rq.nr > 0)
+                send_ipi(c - cpus);
+    }
+}
+
+// could get() on self find something to run: a process in its own
+// queue that is not in a throttled group, or one it may take from
+// another cpu? idle() parks only if not; refresh_groups() wakes it
+// when a throttle is lifted.
+int cpu_has_work(struct cpu *self)
+{
+    if (self->rq.nr > 0) {
+        acquire(&self->rq.lock);
+        int found = (rq_first(&self->rq) != 0);
+        release(&self->rq.lock);
+        if (found) return 1;
+    }
+    return can_steal(self);
+}
+
+// take the next process from the calling cpu's run queue,
+// stealing one from the busiest other cpu if that queue is empty
+struct proc* get()
+{
+    struct proc* ret = 0;
+    push_off();
+    struct cpu *c = mycpu();
+    struct runqueue *rq = &c->rq;
+
+    // a cpu whose waiting processes are all throttled polls here,
+    // so it must notice itself when their next period starts.
+    refresh_groups(sched_clock());
+
+    // an idle cpu polls here continuously, so only touch the lock
+    // when the (unlocked) size says there is something to take.
+    if (rq->nr > 0) {
+        acquire(&rq->lock);
+        ret = rq_pop_warm(rq, c);
+        release(&rq->lock);
+        if (ret != 0) trace_sched(TR_DEQUEUE, ret, c - cpus, 0);
+    }
+
+    if (ret == 0) ret = steal(c);
+    if (ret != 0) {
+        if (ret->last_cpu >= 0 && ret->last_cpu != c - cpus)
+            ret->nr_migrations++;
+        ret->last_cpu = c - cpus;
+        ret->cpu_burst = 0;
+        // the group loads are read without the lock; the slice is a target, not a contract.
+        if (ret->sched_class != SCHED_NORMAL)
+            ret->timeslice = (ret->sched_class == SCHED_RR ? proc_sched.rr_quantum : 0);
+        else if (proc_sched.algorithm == 1)
+            ret->timeslice = cfs_timeslice(rq, ret);
+        else if (proc_sched.algorithm == 2)
+            ret->timeslice = mlfq_timeslice(ret);
+        else
+            ret->timeslice = 0;
+        // started by a gang mate: end together with it
+        if (ret->gang_slice != 0) {
+            ret->timeslice = ret->gang_slice;
+            ret->gang_slice = 0;
+        }
+    }
+    pop_off();
+    return ret;
+}
+
+// periodically called from timer_routine(): if the busiest other cpu
+// has at least two more processes waiting than this one, move its best
+// waiting process over here. both run queue locks are taken in cpu
+// order, as in change_sched().
+static void rebalance(void)
+{
+    push_off();
+    struct cpu *self = mycpu();
+    struct cpu *busiest = busiest_cpu(self);
+
+    if (busiest != 0 && busiest->rq.nr - self->rq.nr >= 2) {
+        struct cpu *first = (busiest < self ? busiest : self);
+        struct cpu *second = (busiest < self ? self : busiest);
+        acquire(&first->rq.lock);
+        acquire(&second->rq.lock);
+        struct proc *p;
+        if (busiest->rq.nr - self->rq.nr >= 2 && (p = rq_pop_allowed(&busiest->rq, self)) != 0) {
+            rq_migrate(&busiest->rq, &self->rq, p);
+            rq_push(&self->rq, p);
+            trace_sched(TR_MIGRATE, p, self - cpus, busiest - cpus);
+        }
+        release(&second->rq.lock);
+        release(&first->rq.lock);
+    }
+    pop_off();
+}
+
+// move the waiting process p to the head of its run queue.
+// p->lock must be held.
+void requeue_front(struct proc *p)
+{
+    struct runqueue *rq = lock_queued(p);
+    if (rq == 0) return;
+
+    if (rq->next == p) {
+        // already first
+    } else if (p->sched_class != SCHED_NORMAL) {
+        prioq_remove(&rq->rt, p, p->rt_prio);
+        prioq_push_front(&rq->rt, p, p->rt_prio);
+    } else if (proc_sched.algorithm == 0) {
+        p->cpu_burst_aprox = 0;
+        p->sjf_key = 0;
+        heap_decrease_key((struct proc**) &rq->heap, p->heap_index, proc_sched.algorithm);
+    } else if (proc_sched.algorithm == 2) {
+        prioq_remove(&rq->mlfq, p, p->mlfq_level);
+        p->mlfq_level = 0;
+        prioq_push_front(&rq->mlfq, p, 0);
+    } else {
+        cfs_dequeue(rq, p);
+        cfs_enqueue_front(rq, p);
+    }
+    release(&rq->lock);
+}
+
+// give p a new cfs weight. a waiting process is re-inserted so its
+// queue's load stays consistent; otherwise only the field changes.
+// p->lock must be held.
+void reweight(struct proc *p, int weight)
+{
+    struct runqueue *rq = lock_queued(p);
+    if (rq == 0) {
+        p->weight = weight;
+        return;
+    }
+    rq_remove(rq, p);
+    p->weight = weight;
+    rq_push(rq, p);
+    release(&rq->lock);
+}
+
+// move p to scheduling class cls at real-time priority prio. a waiting
+// process is re-queued in the lists of its new class. p->lock must be
+// held.
+void setclass(struct proc *p, int cls, int prio)
+{
+    struct runqueue *rq = lock_queued(p);
+    if (rq == 0) {
+        p->sched_class = cls;
+        p->rt_prio = prio;
+        return;
+    }
+    rq_remove(rq, p);
+    p->sched_class = cls;
+    p->rt_prio = prio;
+    rq_push(rq, p);
+    release(&rq->lock);
+}
+
+// restrict p to the cpus in mask. a waiting p is queued again on a
+// cpu chosen as for a wakeup; a running p is made to reschedule if its
+// cpu is no longer allowed, and put() then places it. p->lock must be
+// held.
+void set_cpus_allowed(struct proc *p, uint64 mask)
+{
+    struct runqueue *rq = lock_queued(p);
+    if (rq == 0) {
+        p->affinity = mask;
+        for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+            if (c->proc == p && !cpu_allowed(p, c)) {
+                c->need_resched = 1;
+                send_ipi(c - cpus);
+            }
+        }
+        return;
+    }
+    rq_remove(rq, p);
+    p->affinity = mask;
+    release(&rq->lock);
+
+    int preempt;
+    struct cpu *target = pick_cpu(p, &preempt);
+    acquire(&target->rq.lock);
+    rq_migrate(rq, &target->rq, p);
+    rq_push(&target->rq, p);
+    release(&target->rq.lock);
+    kick(target, preempt);
+}
+
+// gang scheduling: mate, a waiting member of the gang of a process
+// about to run on cpu leader with timeslice slice, should start now
+// too. hand it to another cpu that is idle, or else running a normal
+// process from outside the gang, as that cpu's rq->next, and have the
+// cpu reschedule. mate->lock must be held.
+void gang_place(struct proc *mate, int leader, uint64 slice)
+{
+    struct cpu *target = 0;
+
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++) {
+        struct proc *r = c->proc;
+        if (c - cpus == leader || !c->online || !cpu_allowed(mate, c) || c->rq.next != 0)
+            continue;
+        if (r == 0 && c->idle) {
+            target = c;
+            break;
+        }
+        if (r != 0 && r->gang != mate->gang && r->sched_class == SCHED_NORMAL && target == 0)
+            target = c;
+    }
+    if (target == 0) return;
+
+    struct runqueue *rq = lock_queued(mate);
+    if (rq == 0) return;
+    rq_remove(rq, mate);
+    release(&rq->lock);
+
+    acquire(&target->rq.lock);
+    rq_migrate(rq, &target->rq, mate);
+    if (target->rq.next == 0)
+        rq_push_next(&target->rq, mate);
+    else
+        rq_push(&target->rq, mate); // taken meanwhile
+    mate->gang_slice = slice;
+    release(&target->rq.lock);
+    kick(target, 1);
+}
+
+// move p to scheduling group g. a waiting process is re-queued in
+// its new group's tree. p->lock must be held.
+void regroup(struct proc *p, int g)
+{
+    struct runqueue *rq = lock_queued(p);
+    if (rq == 0) {
+        p->group = g;
+        return;
+    }
+    rq_remove(rq, p);
+    p->group = g;
+    if (proc_sched.algorithm == 1 && p->sched_class == SCHED_NORMAL)
+        cfs_place(rq, p);
+    rq_push(rq, p);
+    release(&rq->lock);
+}
+
+//////////////////
+
+// move every process waiting in rq from the structure used by
+// proc_sched.algorithm into the one used by algo. they are taken out
+// best first and queued again under algo. called with every run
+// queue locked, so proc_sched.algorithm may be switched meanwhile.
+// rekey queues them again even if algo does not change.
+static void rq_convert(struct runqueue *rq, int algo, int rekey)
+{
+    struct proc *waiting[NPROC];
+    int from = proc_sched.algorithm;
+    int n = 0;
+
+    // other parameters do not change any key, so the queue stays as it is.
+    if (algo == from && !rekey) return;
+
+    // throttled cfs groups are emptied too, so not through rq_pop().
+    // rq_first() takes the rt class and the gang slot first.
+    while (rq->nr > 0) {
+        struct proc *p = (from == 1 && rq->rt.bitmap == 0 && rq->next == 0 ? cfs_any(rq) : rq_first(rq));
+        rq_remove(rq, p);
+        waiting[n++] = p;
+    }
+    proc_sched.algorithm = algo;
+    for (int i = 0; i < n; i++)
+        rq_push(rq, waiting[i]);
+    proc_sched.algorithm = from;
+}
+
+// the policy parameters in proc_sched only change with proc_sched.lock
+// and then every run queue lock held, always taken in cpu order.
+static void lock_policy(void)
+{
+    acquire(&proc_sched.lock);
+    for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+        acquire(&c->rq.lock);
+}
+
+static void unlock_policy(void)
+{
+    for (struct cpu *c = &cpus[NCPU-1]; c >= cpus; c--)
+        release(&c->rq.lock);
+    release(&proc_sched.lock);
+}
+
+// when changing the process scheduling policy, every run queue must be
+// re-sorted by the new criteria, at O(log n) per process. run queue locks are always taken in
+// cpu order so two concurrent change_sched() calls cannot deadlock.
+//
+// is_preemptive makes sjf preempt a process when a shorter one waits;
+// a is the weight, 0..100, of the last burst in each process's burst
+// prediction, kept under every algorithm. aging is the % of its waiting
+// time taken off a process's predicted burst when ordering the sjf
+// queue, 0..1000; 0 disables it, and it must be 0 for cfs and mlfq.
+// the cfs latency and the mlfq boost period have calls of their own,
+// setlatency() and setboost(), as the quanta have setquantum().
+int change_sched(int algo, int is_preemptive, int a, int aging){
+    if (algo < 0 || algo >= NSCHED || is_preemptive<0) return -2;
+    if (a<0 || a>100) return -3;
+    if (aging < 0 || aging > 1000 || (algo != 0 && aging != 0)) return -3;
+    struct cpu *c;
+
+    lock_policy();
+    // sjf keys depend on the aging rate
+    int rekey = (algo == 0 && proc_sched.algorithm == 0 && aging != proc_sched.aging);
+    if (algo == 0)
+        proc_sched.aging = aging;
+    for (c = cpus; c < &cpus[NCPU]; c++)
+        rq_convert(&c->rq, algo, rekey);
+
+    proc_sched.algorithm = algo;
+    proc_sched.is_preemptive = is_preemptive;
+    proc_sched.a = a;
+
+    unlock_policy();
+    return 0;
+}
+
+// set the timer interrupt interval, in microseconds.
+int settick(int usec)
+{
+    if (usec < 100 || usec > 10000000) return -1;
+    timer_setinterval(usec);
+    return 0;
+}
+
+// set the cache-hot tolerance for migration, in microseconds.
+int setcachetol(int usec)
+{
+    if (usec < 0) return -1;
+    lock_policy();
+    proc_sched.cache_tolerance = usec * 1000UL;
+    unlock_policy();
+    return 0;
+}
+
+// set group g's cpu shares, and its quota of cpu time per period,
+// summed over all cpus (0 for none). the root group, 0, where init
+// and everything not placed elsewhere runs, cannot be limited.
+int groupctl(int g, int shares, int quota_usec, int period_usec)
+{
+    if (g < 0 || g >= NGROUP || shares < 1 || shares > 100 * NICE_0_WEIGHT) return -1;
+    if (quota_usec < 0 || (quota_usec > 0 && (g == 0 || period_usec < 1000))) return -1;
+    struct schedgroup *grp = &sched_groups[g];
+
+    lock_policy();
+    grp->shares = shares;
+    grp->quota = quota_usec * 1000UL;
+    if (quota_usec > 0) grp->period = period_usec * 1000UL;
+    grp->period_start = sched_clock();
+    grp->used = 0;
+    grp->throttled = 0;
+    unlock_policy();
+    return 0;
+}
+
+// set the cfs target latency, in microseconds: the period in which
+// every waiting process should run once. no less than the cfs quantum.
+int setlatency(int usec)
+{
+    if (usec <= 0) return -1;
+    uint64 latency = usec * 1000UL;
+
+    lock_policy();
+    if (latency < proc_sched.quantum[1]) {
+        unlock_policy();
+        return -1;
+    }
+    proc_sched.sched_latency = latency;
+    unlock_policy();
+    return 0;
+}
+
+// set the mlfq boost period, in microseconds.
+int setboost(int usec)
+{
+    if (usec <= 0) return -1;
+    lock_policy();
+    proc_sched.mlfq_boost = usec * 1000UL;
+    unlock_policy();
+    return 0;
+}
+
+// set the default quantum of scheduling algorithm algo, in microseconds.
+int setquantum(int algo, int usec)
+{
+    if (algo < 0 || algo >= NSCHED || usec <= 0) return -1;
+    uint64 quantum = usec * 1000UL;
+
+    lock_policy();
+    if (algo == 1 && quantum > proc_sched.sched_latency) {
+        unlock_policy();
+        return -1;
+    }
+    proc_sched.quantum[algo] = quantum;
+    unlock_policy();
+    return 0;
+}
+
+//////////////////////////
+
+// charge the running process p for the time since it was dispatched
+// or last charged: its burst, its total and, scaled by its weight,
+// its cfs vruntime. called with p running on this cpu.
+void update_curr(struct proc* p)
+{
+    uint64 now = sched_clock();
+    uint64 delta = now - p->run_start;
+
+    p->run_start = now;
+    p->cpu_burst += delta;
+    p->run_time += delta;
+    p->vruntime += cfs_scale(delta, p->weight);
+    if (p->sched_class != SCHED_NORMAL) return;
+
+    // p's group: its position on this cpu, and its quota on all of them.
+    // the position is only charged here; the lock holder folds it in.
+    struct schedgroup *g = &sched_groups[p->group];
+    push_off();
+    __sync_fetch_and_add(&mycpu()->rq.cfs[p->group].charge, cfs_scale(delta, g->shares));
+    pop_off();
+    if (g->quota != 0 && __sync_add_and_fetch(&g->used, delta) >= g->quota)
+        g->throttled = 1;
+}
+
+// preemptive sjf: should the running process p give up the cpu?
+// only once it has run for the sjf quantum, and only if a process
+// predicted to be shorter than what p has left, after aging, is
+// waiting here.
+// otherwise the yield would just put p back at the top of the heap.
+static int sjf_should_preempt(struct proc *p)
+{
+    if (p->cpu_burst < proc_sched.quantum[0]) return 0;
+
+    uint64 left = (p->cpu_burst_aprox > p->cpu_burst ? p->cpu_burst_aprox - p->cpu_burst : 0);
+    int shorter = 0;
+
+    // peek at the heap top without the lock, as every tick does: a
+    // stale answer costs one needless or one late preemption, and
+    // yield() takes the lock anyway when one is due.
+    push_off();
+    struct runqueue *rq = &mycpu()->rq;
+    struct proc *top = (rq->heap_size > 0 ? rq->heap[0] : 0);
+    if (top != 0)
+        shorter = (sjf_aged(top, sched_clock()) < left);
+    pop_off();
+    return shorter;
+}
+
+// reschedule ipi routine called from trap.c: put() queued a process
+// that should preempt p, or p may no longer run on this cpu.
+void ipi_routine(struct proc* p)
+{
+    push_off();
+    int resched = __sync_lock_test_and_set(&mycpu()->need_resched, 0);
+    pop_off();
+
+    if (resched)
+        yield();
+}
+
+// mlfq, called every tick: flatten this cpu's levels if the boost
+// period has passed, and tell whether a process of a higher level
+// than the running p is waiting here.
+static int mlfq_should_preempt(struct proc *p)
+{
+    uint64 now = sched_clock();
+    int higher;
+
+    push_off();
+    struct runqueue *rq = &mycpu()->rq;
+    if (now - rq->mlfq_boosted >= proc_sched.mlfq_boost) {
+        acquire(&rq->lock);
+        if (proc_sched.algorithm == 2)
+            mlfq_boost(rq);
+        rq->mlfq_boosted = now;
+        release(&rq->lock);
+        p->mlfq_level = 0;
+    }
+    // the bitmap is read without the lock: a late preemption is one tick late
+    higher = (prioq_top(&rq->mlfq) < p->mlfq_level);
+    pop_off();
+    return higher;
+}
+
+// is a real-time process that should run before p waiting here?
+// the bitmap is read without the lock, so this is only a hint.
+static int rt_should_preempt(struct proc *p)
+{
+    push_off();
+    int top = prioq_top(&mycpu()->rq.rt);
+    pop_off();
+    if (p->sched_class == SCHED_NORMAL)
+        return top < NPRIOQ;
+    return top < p->rt_prio;
+}
+
+// timer interrupt routine called from trap.c, on every hart every
+// tick. p's accounting is its own, and the checks below peek at this
+// cpu's queue without its lock, so a tick that changes nothing takes
+// no lock; one is taken only to reschedule, rebalance or boost.
+void timer_routine(struct proc* p)
+{
+    update_curr(p);
+    refresh_groups(sched_clock());
+
+    push_off();
+    struct cpu *c = mycpu();
+    int balance = (++c->balance_ticks >= SCHED_BALANCE_TICKS);
+    if (balance) c->balance_ticks = 0;
+    // an ipi pending with this tick was acknowledged along with it, and
+    // devintr() reports only the tick: act on its request here.
+    int resched = __sync_lock_test_and_set(&c->need_resched, 0);
+    pop_off();
+    if (balance) rebalance();
+
+    //printf("timer | pid: %d | cpu_burst: %d\n", myproc()->pid, myproc()->cpu_burst);
+
+    // real-time processes are only preempted by higher real-time
+    // priorities and, under SCHED_RR, at the end of their quantum.
+    if (p->sched_class != SCHED_NORMAL) {
+        if (resched || (p->timeslice != 0 && p->cpu_burst >= p->timeslice) || rt_should_preempt(p))
+            yield();
+        return;
+    }
+
+    if (resched ||
+        (p->timeslice != 0 && p->cpu_burst >= p->timeslice) ||
+        rt_should_preempt(p) ||
+        (proc_sched.algorithm == 1 && sched_groups[p->group].throttled) ||
+        (proc_sched.algorithm == 0 && proc_sched.is_preemptive==1 && sjf_should_preempt(p)) ||
+        (proc_sched.algorithm == 2 && mlfq_should_preempt(p)))
+        yield();
+}
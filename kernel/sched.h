@@ -0,0 +1,4 @@
+// Scheduling classes, see setsched().
+#define SCHED_NORMAL  0   // scheduled by proc_sched.algorithm: sjf, cfs or mlfq
+#define SCHED_FIFO    1   // real-time: runs until it sleeps or a higher rt_prio wakes
+#define SCHED_RR      2   // real-time: like SCHED_FIFO, round robin within an rt_prio
@@ -0,0 +1,18 @@
+// Scheduler statistics for one process, see schedstat().
+// Times are in nanoseconds, measured with the CLINT's mtime.
+struct schedstat {
+  int pid;
+  int state;                 // enum procstate in proc.h
+  int nice;
+  int group;                 // CFS scheduling group
+  char name[16];
+  uint64 run;                // total time on a cpu
+  uint64 wait;               // total time RUNNABLE in a run queue
+  uint64 nvcsw;              // switches out to sleep or exit
+  uint64 nivcsw;             // switches out while still runnable
+  uint64 last_burst;         // length of the last finished cpu burst
+  uint64 last_burst_aprox;   // what sjf had predicted for it
+  uint64 burst_aprox;        // sjf prediction of the next burst
+  int cpu;                   // cpu it last ran on, or -1
+  uint64 migrations;         // times it ran on a different cpu than the time before
+};
@@ -0,0 +1,148 @@
+// Scheduler event trace.
+//
+// Each cpu has a ring of the last SCHED_TRACE_LEN events it recorded.
+// Only that cpu writes its ring, with interrupts off, so recording an
+// event takes no lock: the slot is filled, then head is advanced.
+// When a ring is full the oldest events are overwritten.
+//
+// schedtrace() drains all rings for user space. It never stops the
+// writers: after copying an event it re-reads head, and drops the copy
+// if the writer may have reused that slot meanwhile. Overwritten and
+// dropped events are reported as a TR_LOST event.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "schedtrace.h"
+
+struct tracering {
+  uint64 head;   // events ever recorded; written only by the owning cpu
+  uint64 tail;   // next event to drain; protected by drain_lock
+  uint64 lost;   // events lost but not yet reported; protected by drain_lock
+  struct schedevent ev[SCHED_TRACE_LEN];
+} __attribute__((aligned(64)));
+
+static struct tracering rings[NCPU];
+static struct spinlock drain_lock;
+
+// events on their way to user space in schedtrace().
+struct drain {
+  uint64 addr;   // user buffer
+  int n;         // its size in events
+  int copied;    // events already copied out
+  int nbuf;
+  struct schedevent buf[16];
+};
+
+void
+schedtraceinit(void)
+{
+  initlock(&drain_lock, "schedtrace");
+}
+
+// record an event on the calling cpu's ring.
+void
+trace_sched(int type, struct proc *p, int hart, int other)
+{
+  push_off();
+  struct tracering *r = &rings[cpuid()];
+  struct schedevent *e = &r->ev[r->head % SCHED_TRACE_LEN];
+
+  e->time = sched_clock();
+  e->burst = p->cpu_burst_aprox;
+  e->pid = p->pid;
+  e->type = type;
+  e->hart = hart;
+  e->other = other;
+  __sync_synchronize();
+  r->head++;
+  pop_off();
+}
+
+static int
+drain_flush(struct drain *d)
+{
+  uint64 dst = d->addr + d->copied * sizeof(struct schedevent);
+
+  if(copyout(myproc()->pagetable, dst, (char *)d->buf, d->nbuf * sizeof(struct schedevent)) < 0)
+    return -1;
+  d->copied += d->nbuf;
+  d->nbuf = 0;
+  return 0;
+}
+
+static int
+drain_full(struct drain *d)
+{
+  return d->copied + d->nbuf >= d->n;
+}
+
+// move the events of ring r to d, as many as fit. returns -1 if
+// the copy to user space fails.
+static int
+drain_ring(struct drain *d, struct tracering *r, int hart)
+{
+  uint64 head = r->head;
+  __sync_synchronize();
+
+  if(head - r->tail > SCHED_TRACE_LEN){
+    r->lost += head - SCHED_TRACE_LEN - r->tail;
+    r->tail = head - SCHED_TRACE_LEN;
+  }
+  if(r->lost && !drain_full(d)){
+    struct schedevent *e = &d->buf[d->nbuf++];
+    memset(e, 0, sizeof(*e));
+    e->time = sched_clock();
+    e->burst = r->lost;
+    e->type = TR_LOST;
+    e->hart = hart;
+    r->lost = 0;
+    if(d->nbuf == NELEM(d->buf) && drain_flush(d) < 0)
+      return -1;
+  }
+  while(r->tail != head && !drain_full(d)){
+    uint64 i = r->tail++;
+    d->buf[d->nbuf] = r->ev[i % SCHED_TRACE_LEN];
+    __sync_synchronize();
+    if(r->head - i >= SCHED_TRACE_LEN){
+      r->lost++;   // the writer may have been refilling this slot
+      continue;
+    }
+    if(++d->nbuf == NELEM(d->buf) && drain_flush(d) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// copy up to n recorded events to user address addr, oldest first
+// within each cpu. returns the number copied, or -1.
+int
+schedtrace(uint64 addr, int n)
+{
+  struct drain d;
+
+  if(n < 0)
+    return -1;
+  d.addr = addr;
+  d.n = n;
+  d.copied = 0;
+  d.nbuf = 0;
+
+  acquire(&drain_lock);
+  for(int c = 0; c < NCPU; c++){
+    if(drain_ring(&d, &rings[c], c) < 0)
+      goto bad;
+  }
+  if(d.nbuf > 0 && drain_flush(&d) < 0)
+    goto bad;
+  release(&drain_lock);
+  return d.copied;
+
+bad:
+  release(&drain_lock);
+  return -1;
+}
@@ -0,0 +1,21 @@
+// Scheduler trace events, see schedtrace.c.
+// Drained from the kernel in bulk with the schedtrace() syscall.
+
+#define TR_ENQUEUE    1  // put() queued pid on hart
+#define TR_DEQUEUE    2  // get() took pid from hart's queue
+#define TR_SWITCH_IN  3  // scheduler() on hart switched to pid
+#define TR_SWITCH_OUT 4  // pid gave up hart; other = its new state
+#define TR_WAKEUP     5  // a sleeping pid was made runnable on hart
+#define TR_MIGRATE    6  // pid moved from other's queue to hart's
+#define TR_SLEEP      7  // pid went to sleep on hart
+#define TR_LOST       8  // arg events on hart were overwritten before drain
+
+struct schedevent {
+  uint64 time;         // sched_clock(), ns since boot
+  uint64 burst;        // sjf prediction (or lost count for TR_LOST)
+  int pid;
+  uchar type;          // TR_*
+  uchar hart;
+  uchar other;         // source hart for TR_MIGRATE, state for TR_SWITCH_OUT
+  uchar pad;
+};
@@ -0,0 +1,173 @@
+// Slab allocator for fixed-size kernel objects.
+//
+// A slabcache hands out objects of one size, carved from whole
+// pages (slabs) taken from kalloc(). Each slab starts with a
+// header holding a stack of the indices of its free objects, so a
+// free object's memory is never written by the allocator: the
+// constructor runs once, when the slab is made, and slabfree()
+// takes the object back in its constructed state. Each cpu keeps
+// up to SLAB_MAG free objects in front of the cache, under its own
+// lock, and moves them to and from the slabs SLAB_BATCH at a time.
+// A slab whose objects are all free goes back to kalloc() unless
+// it is the cache's last partial slab.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "slab.h"
+#include "defs.h"
+
+struct slab {            // header at the start of each slab page
+  struct slabcache *c;
+  struct slab *next;     // on c->partial
+  struct slab *prev;
+  ushort nfree;
+  ushort free[];         // indices of free objects
+};
+
+void
+slabinit(struct slabcache *c, char *name, uint size, void (*ctor)(void*))
+{
+  size = (size + 7) & ~7;
+  uint n = (PGSIZE - sizeof(struct slab)) / (size + sizeof(ushort));
+  while(n > 0 && ((sizeof(struct slab) + n * sizeof(ushort) + 7) & ~7) + n * size > PGSIZE)
+    n--;
+  if(n == 0)
+    panic("slabinit: object too large");
+
+  c->name = name;
+  c->size = size;
+  c->perslab = n;
+  c->objoff = (sizeof(struct slab) + n * sizeof(ushort) + 7) & ~7;
+  c->ctor = ctor;
+  initlock(&c->lock, name);
+  c->partial = 0;
+  for(struct slabcpu *m = c->cpu; m < &c->cpu[NCPU]; m++){
+    initlock(&m->lock, name);
+    m->n = 0;
+  }
+}
+
+static void
+link(struct slabcache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(c->partial)
+    c->partial->prev = s;
+  c->partial = s;
+}
+
+static void
+unlink(struct slabcache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// make a new slab, with every object constructed, and put it on
+// c->partial. c->lock must be held.
+static struct slab*
+newslab(struct slabcache *c)
+{
+  struct slab *s;
+
+  if((s = kalloc()) == 0)
+    return 0;
+  s->c = c;
+  s->nfree = c->perslab;
+  for(int i = 0; i < c->perslab; i++){
+    // hand out the lowest addresses first.
+    s->free[i] = c->perslab - 1 - i;
+    if(c->ctor)
+      c->ctor((char*)s + c->objoff + i * c->size);
+  }
+  link(c, s);
+  return s;
+}
+
+// take a free object from the slabs. c->lock must be held.
+static void*
+getobj(struct slabcache *c)
+{
+  struct slab *s = c->partial;
+
+  if(s == 0 && (s = newslab(c)) == 0)
+    return 0;
+  int i = s->free[--s->nfree];
+  if(s->nfree == 0)
+    unlink(c, s);
+  return (char*)s + c->objoff + i * c->size;
+}
+
+// return object p to its slab. c->lock must be held.
+static void
+putobj(struct slabcache *c, void *p)
+{
+  struct slab *s = (struct slab*)PGROUNDDOWN((uint64)p);
+  uint off = (char*)p - (char*)s - c->objoff;
+
+  if(s->c != c || off % c->size != 0 || off / c->size >= c->perslab)
+    panic("slabfree");
+  if(s->nfree == 0)
+    link(c, s);
+  s->free[s->nfree++] = off / c->size;
+  if(s->nfree == c->perslab && (s->prev || s->next)){
+    unlink(c, s);
+    kfree(s);
+  }
+}
+
+// lock and return the calling cpu's part of c.
+static struct slabcpu*
+mycache(struct slabcache *c)
+{
+  push_off();
+  struct slabcpu *m = &c->cpu[cpuid()];
+  acquire(&m->lock);
+  pop_off();
+  return m;
+}
+
+// allocate a constructed object from c.
+// returns 0 if no memory is left.
+void*
+slaballoc(struct slabcache *c)
+{
+  struct slabcpu *m = mycache(c);
+  void *p = 0;
+
+  if(m->n == 0){
+    acquire(&c->lock);
+    while(m->n < SLAB_BATCH && (p = getobj(c)) != 0)
+      m->obj[m->n++] = p;
+    release(&c->lock);
+  }
+  if(m->n > 0)
+    p = m->obj[--m->n];
+  release(&m->lock);
+  return p;
+}
+
+// free object p, which slaballoc(c) returned. p must be in the
+// state the constructor leaves an object in.
+void
+slabfree(struct slabcache *c, void *p)
+{
+  struct slabcpu *m = mycache(c);
+
+  if(m->n == SLAB_MAG){
+    acquire(&c->lock);
+    for(int i = 0; i < SLAB_BATCH; i++)
+      putobj(c, m->obj[--m->n]);
+    release(&c->lock);
+  }
+  m->obj[m->n++] = p;
+  release(&m->lock);
+}
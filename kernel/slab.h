@@ -0,0 +1,23 @@
+// Object caches for kernel structures smaller than a page.
+// See slab.c.
+
+#define SLAB_MAG   16   // free objects a cpu keeps in front of a cache
+#define SLAB_BATCH  8   // objects moved between a cpu and the slabs at once
+
+struct slabcpu {
+  struct spinlock lock;
+  void *obj[SLAB_MAG];   // free, constructed objects
+  int n;
+} __attribute__ ((aligned (64)));
+
+struct slabcache {
+  char *name;
+  uint size;             // object size, rounded up to 8 bytes
+  uint objoff;           // offset of the first object in a slab page
+  uint perslab;          // objects per slab page
+  void (*ctor)(void*);   // builds an object when its slab is made, or 0
+
+  struct spinlock lock;  // protects partial and the slabs on it
+  struct slab *partial;  // slabs with free objects
+  struct slabcpu cpu[NCPU];
+};
@@ -11,7 +11,7 @@ void timerinit();
 __attribute__ ((aligned (16))) char stack0[4096 * NCPU];
 
 // a scratch area per CPU for machine-mode timer interrupts.
-uint64 timer_scratch[NCPU][5];
+uint64 timer_scratch[NCPU][7];
 
 // assembly code in kernelvec.S for machine-mode timer interrupt.
 extern void timervec();
@@ -65,16 +65,20 @@ timerinit()
   int id = r_mhartid();
 
   // ask the CLINT for a timer interrupt.
-  int interval = 1000000; // cycles; about 1/10th second in qemu.
+  uint64 interval = TICK_USEC * (CLINT_HZ / 1000000); // cycles; 1000000 is 1/10th second in qemu.
   *(uint64*)CLINT_MTIMECMP(id) = *(uint64*)CLINT_MTIME + interval;
 
   // prepare information in scratch[] for timervec.
   // scratch[0..2] : space for timervec to save registers.
   // scratch[3] : address of CLINT MTIMECMP register.
   // scratch[4] : desired interval (in cycles) between timer interrupts.
+  // scratch[5] : address of CLINT MSIP register, for inter-processor interrupts.
+  // scratch[6] : set by timervec when the timer fired, see timer_fired().
   uint64 *scratch = &timer_scratch[id][0];
   scratch[3] = CLINT_MTIMECMP(id);
   scratch[4] = interval;
+  scratch[5] = CLINT_MSIP(id);
+  scratch[6] = 0;
   w_mscratch((uint64)scratch);
 
   // set the machine-mode trap handler.
@@ -83,6 +87,54 @@ timerinit()
   // enable machine-mode interrupts.
   w_mstatus(r_mstatus() | MSTATUS_MIE);
 
-  // enable machine-mode timer interrupts.
-  w_mie(r_mie() | MIE_MTIE);
+  // enable machine-mode timer interrupts, and software
+  // interrupts, which other harts use to send an ipi.
+  w_mie(r_mie() | MIE_MTIE | MIE_MSIE);
+}
+
+// the rest runs in supervisor mode, through the kernel's
+// mapping of the CLINT.
+
+// did this hart's timer fire since the last call?
+// the software interrupt timervec raises for it looks
+// the same as an ipi. interrupts must be disabled.
+int
+timer_fired(void)
+{
+  // atomic swap, so a timer interrupt that lands in
+  // between is not lost.
+  return __sync_lock_test_and_set(&timer_scratch[cpuid()][6], 0) != 0;
+}
+
+// stop this hart's periodic timer interrupts, while it is
+// idle and has no process to preempt.
+// interrupts must be disabled.
+void
+timer_stop(void)
+{
+  *(uint64*)CLINT_MTIMECMP(cpuid()) = ~0ULL;
+}
+
+// change the timer interrupt interval of every hart to usec
+// microseconds. this hart starts a fresh interval now; the others
+// switch over after their next tick. ticks, and so sleep() and
+// uptime(), count in the new unit from then on.
+void
+timer_setinterval(uint64 usec)
+{
+  for(int i = 0; i < NCPU; i++)
+    timer_scratch[i][4] = usec * (CLINT_HZ / 1000000);
+  __sync_synchronize();
+  push_off();
+  timer_start();
+  pop_off();
+}
+
+// resume periodic timer interrupts after timer_stop().
+// interrupts must be disabled.
+void
+timer_start(void)
+{
+  int id = cpuid();
+  *(uint64*)CLINT_MTIMECMP(id) = *(uint64*)CLINT_MTIME + timer_scratch[id][4];
 }
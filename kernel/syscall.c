@@ -105,6 +105,22 @@ extern uint64 sys_wait(void);
 extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
 extern uint64 sys_chsched(void); //
+extern uint64 sys_setnice(void);
+extern uint64 sys_getcputime(void);
+extern uint64 sys_settick(void);
+extern uint64 sys_setquantum(void);
+extern uint64 sys_schedstat(void);
+extern uint64 sys_schedtrace(void);
+extern uint64 sys_uptimens(void);
+extern uint64 sys_setsched(void);
+extern uint64 sys_setaffinity(void);
+extern uint64 sys_setcachetol(void);
+extern uint64 sys_setgroup(void);
+extern uint64 sys_groupctl(void);
+extern uint64 sys_setgang(void);
+extern uint64 sys_buddyinfo(void);
+extern uint64 sys_setlatency(void);
+extern uint64 sys_setboost(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -128,7 +144,23 @@ static uint64 (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
-[SYS_chsched] sys_chsched
+[SYS_chsched] sys_chsched,
+[SYS_setnice] sys_setnice,
+[SYS_getcputime] sys_getcputime,
+[SYS_settick] sys_settick,
+[SYS_setquantum] sys_setquantum,
+[SYS_schedstat] sys_schedstat,
+[SYS_schedtrace] sys_schedtrace,
+[SYS_uptimens] sys_uptimens,
+[SYS_setsched] sys_setsched,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_setcachetol] sys_setcachetol,
+[SYS_setgroup] sys_setgroup,
+[SYS_groupctl] sys_groupctl,
+[SYS_setgang] sys_setgang,
+[SYS_buddyinfo] sys_buddyinfo,
+[SYS_setlatency] sys_setlatency,
+[SYS_setboost] sys_setboost,
 };
 
 void
@@ -21,3 +21,19 @@
 #define SYS_mkdir  20
 #define SYS_close  21
 #define SYS_chsched 22
+#define SYS_setnice 23
+#define SYS_getcputime 24
+#define SYS_settick 25
+#define SYS_setquantum 26
+#define SYS_schedstat 27
+#define SYS_schedtrace 28
+#define SYS_uptimens 29
+#define SYS_setsched 30
+#define SYS_setaffinity 31
+#define SYS_setcachetol 32
+#define SYS_setgroup 33
+#define SYS_groupctl 34
+#define SYS_setgang 35
+#define SYS_buddyinfo 36
+#define SYS_setlatency 37
+#define SYS_setboost 38
@@ -14,12 +14,208 @@ sys_chsched(void)
     int algo;
     int is_preemptive;
     int a;
+    int aging;
 
     if(argint(0, &algo)<0) return -1;
     if(argint(1, &is_preemptive)<0) return -1;
     if(argint(2, &a)<0) return -1;
+    if(argint(3, &aging)<0) return -1;
 
-    return change_sched(algo, is_preemptive, a);
+    return change_sched(algo, is_preemptive, a, aging);
+}
+
+// system call for changing a process's cfs nice value
+uint64
+sys_setnice(void)
+{
+    int pid;
+    int nice;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argint(1, &nice)<0) return -1;
+
+    return setnice(pid, nice);
+}
+
+// system call for changing a process's scheduling class
+uint64
+sys_setsched(void)
+{
+    int pid;
+    int cls;
+    int prio;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argint(1, &cls)<0) return -1;
+    if(argint(2, &prio)<0) return -1;
+
+    return setsched(pid, cls, prio);
+}
+
+// system call for setting how far a cache-warm process may trail
+// the best one and still be picked first
+uint64
+sys_setcachetol(void)
+{
+    int usec;
+
+    if(argint(0, &usec)<0) return -1;
+
+    return setcachetol(usec);
+}
+
+// system call for setting the cfs target latency
+uint64
+sys_setlatency(void)
+{
+    int usec;
+
+    if(argint(0, &usec)<0) return -1;
+
+    return setlatency(usec);
+}
+
+// system call for setting the mlfq boost period
+uint64
+sys_setboost(void)
+{
+    int usec;
+
+    if(argint(0, &usec)<0) return -1;
+
+    return setboost(usec);
+}
+
+// system call for putting a process in a gang
+uint64
+sys_setgang(void)
+{
+    int pid;
+    int g;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argint(1, &g)<0) return -1;
+
+    return setgang(pid, g);
+}
+
+// system call for reading the free block counts of the buddy allocator
+uint64
+sys_buddyinfo(void)
+{
+    uint64 counts;
+    int n;
+
+    if(argaddr(0, &counts)<0) return -1;
+    if(argint(1, &n)<0) return -1;
+
+    return buddyinfo(counts, n);
+}
+
+// system call for moving a process to a scheduling group
+uint64
+sys_setgroup(void)
+{
+    int pid;
+    int g;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argint(1, &g)<0) return -1;
+
+    return setgroup(pid, g);
+}
+
+// system call for setting a scheduling group's shares and quota
+uint64
+sys_groupctl(void)
+{
+    int g;
+    int shares;
+    int quota;
+    int period;
+
+    if(argint(0, &g)<0) return -1;
+    if(argint(1, &shares)<0) return -1;
+    if(argint(2, &quota)<0) return -1;
+    if(argint(3, &period)<0) return -1;
+
+    return groupctl(g, shares, quota, period);
+}
+
+// system call for restricting a process to a set of cpus
+uint64
+sys_setaffinity(void)
+{
+    int pid;
+    uint64 mask;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argaddr(1, &mask)<0) return -1;
+
+    return setaffinity(pid, mask);
+}
+
+// system call for reading a process's scheduler time accounting
+uint64
+sys_getcputime(void)
+{
+    int pid;
+    uint64 ct;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argaddr(1, &ct)<0) return -1;
+
+    return getcputime(pid, ct);
+}
+
+// system call for reading a process's scheduler statistics
+uint64
+sys_schedstat(void)
+{
+    int pid;
+    uint64 st;
+
+    if(argint(0, &pid)<0) return -1;
+    if(argaddr(1, &st)<0) return -1;
+
+    return schedstat(pid, st);
+}
+
+// system call for draining the scheduler event trace
+uint64
+sys_schedtrace(void)
+{
+    uint64 buf;
+    int n;
+
+    if(argaddr(0, &buf)<0) return -1;
+    if(argint(1, &n)<0) return -1;
+
+    return schedtrace(buf, n);
+}
+
+// system call for changing the timer interrupt interval
+uint64
+sys_settick(void)
+{
+    int usec;
+
+    if(argint(0, &usec)<0) return -1;
+
+    return settick(usec);
+}
+
+// system call for changing a scheduling algorithm's default quantum
+uint64
+sys_setquantum(void)
+{
+    int algo;
+    int usec;
+
+    if(argint(0, &algo)<0) return -1;
+    if(argint(1, &usec)<0) return -1;
+
+    return setquantum(algo, usec);
 }
 
 uint64
@@ -77,13 +273,16 @@ sys_sleep(void)
     return -1;
   acquire(&tickslock);
   ticks0 = ticks;
+  ticksleepers++;
   while(ticks - ticks0 < n){
     if(myproc()->killed){
+      ticksleepers--;
       release(&tickslock);
       return -1;
     }
     sleep(&ticks, &tickslock);
   }
+  ticksleepers--;
   release(&tickslock);
   return 0;
 }
@@ -110,3 +309,10 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// return nanoseconds since boot, from the CLINT's mtime.
+uint64
+sys_uptimens(void)
+{
+  return sched_clock();
+}
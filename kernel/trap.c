@@ -8,6 +8,7 @@
 
 struct spinlock tickslock;
 uint ticks;
+uint ticksleepers;    // processes in sys_sleep(), so clockintr() can skip wakeup()
 
 extern char trampoline[], uservec[], userret[];
 
@@ -67,6 +68,8 @@ usertrap(void)
     intr_on();
 
     syscall();
+  } else if(r_scause() == 15 && cowfault(p->pagetable, r_stval()) == 0){
+    // store to a copy-on-write page, which now has its own copy.
   } else if((which_dev = devintr()) != 0){
     // ok
   } else {
@@ -82,6 +85,10 @@ usertrap(void)
   if(which_dev == 2) {
       timer_routine(p);
   }
+  // or if another hart asked this one to reschedule.
+  if(which_dev == 3) {
+      ipi_routine(p);
+  }
 
   usertrapret();
 }
@@ -156,24 +163,49 @@ kerneltrap()
   if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING) {
       timer_routine(myproc());
   }
+  if(which_dev == 3 && myproc() != 0 && myproc()->state == RUNNING) {
+      ipi_routine(myproc());
+  }
   // the yield() may have caused some traps to occur,
   // so restore trap registers for use by kernelvec.S's sepc instruction.
   w_sepc(sepc);
   w_sstatus(sstatus);
 }
 
+// nanoseconds since boot, from the CLINT's mtime, which unlike
+// ticks advances between timer interrupts and on every hart.
+uint64
+sched_clock(void)
+{
+  return *(uint64*)CLINT_MTIME * (1000000000L / CLINT_HZ);
+}
+
+// interrupt the given hart, e.g. to wake it from wfi.
+// the CLINT only lets machine mode be interrupted this way,
+// so timervec in kernelvec.S turns it into a supervisor
+// software interrupt.
+void
+send_ipi(int hart)
+{
+  __sync_synchronize();
+  *(uint32*)CLINT_MSIP(hart) = 1;
+}
+
 void
 clockintr()
 {
   acquire(&tickslock);
   ticks++;
-  wakeup(&ticks);
+  // wakeup() takes every process's lock; most ticks nobody is waiting.
+  if(ticksleepers > 0)
+    wakeup(&ticks);
   release(&tickslock);
 }
 
 // check if it's an external interrupt or software interrupt,
 // and handle it.
 // returns 2 if timer interrupt,
+// 3 if ipi from another hart,
 // 1 if other device,
 // 0 if not recognized.
 int
@@ -204,16 +236,24 @@ devintr()
 
     return 1;
   } else if(scause == 0x8000000000000001L){
-    // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // software interrupt from a machine-mode timer interrupt
+    // or from another hart's send_ipi(), both forwarded by
+    // timervec in kernelvec.S.
+
+    // acknowledge the software interrupt by clearing
+    // the SSIP bit in sip. do it before looking at what
+    // caused it, so that a later one is not lost.
+    w_sip(r_sip() & ~2);
+
+    if(!timer_fired()){
+      // an ipi, sent to wake this hart from wfi or
+      // to have it reschedule, see put().
+      return 3;
+    }
 
     if(cpuid() == 0){
       clockintr();
     }
-    
-    // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
-    w_sip(r_sip() & ~2);
 
     return 2;
   } else {
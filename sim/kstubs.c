@@ -0,0 +1,299 @@
+// Kernel side of the scheduler simulator: the few kernel services
+// kernel/sched.c needs (cpus, locks, the clock, ipis, yield), reduced
+// to a single host thread, plus the sim_* calls the driver uses to act
+// out what scheduler(), sleep() and the trap handlers would do.
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/riscv.h"
+#include "kernel/spinlock.h"
+#include "kernel/proc.h"
+#include "kernel/schedtrace.h"
+#include "kernel/defs.h"
+#include "sim/sim.h"
+
+struct cpu cpus[NCPU];
+
+static struct proc procs[NPROC];
+static int nprocs;
+static int ncpus;
+static int cur;                 // the cpu "executing" kernel code
+static uint64 now;
+static int ipi_pending[NCPU];
+
+struct cpu*
+mycpu(void)
+{
+  return &cpus[cur];
+}
+
+int
+cpuid(void)
+{
+  return cur;
+}
+
+struct proc*
+myproc(void)
+{
+  return mycpu()->proc;
+}
+
+// there is only one thread, so a lock that is already held when it
+// is acquired means the lock order in sched.c is broken.
+void
+initlock(struct spinlock *lk, char *name)
+{
+  lk->name = name;
+  lk->locked = 0;
+  lk->cpu = 0;
+}
+
+void
+acquire(struct spinlock *lk)
+{
+  if(lk->locked)
+    sim_panic(lk->name);
+  lk->locked = 1;
+}
+
+void
+release(struct spinlock *lk)
+{
+  if(!lk->locked)
+    sim_panic(lk->name);
+  lk->locked = 0;
+}
+
+int
+holding(struct spinlock *lk)
+{
+  return lk->locked;
+}
+
+void
+push_off(void)
+{
+}
+
+void
+pop_off(void)
+{
+}
+
+void
+panic(char *s)
+{
+  sim_panic(s);
+}
+
+uint64
+sched_clock(void)
+{
+  return now;
+}
+
+void
+send_ipi(int hart)
+{
+  ipi_pending[hart] = 1;
+}
+
+void
+timer_setinterval(uint64 usec)
+{
+}
+
+void
+trace_sched(int type, struct proc *p, int hart, int other)
+{
+}
+
+// the bookkeeping sched() does before switching away from p.
+static void
+switch_out(struct proc *p)
+{
+  if(p->state == RUNNABLE){
+    p->nivcsw++;
+  } else {
+    update_curr(p);
+    p->nvcsw++;
+  }
+  mycpu()->proc = 0;
+}
+
+void
+yield(void)
+{
+  struct proc *p = myproc();
+  acquire(&p->lock);
+  put(p);
+  switch_out(p);
+  release(&p->lock);
+}
+
+int
+sim_reset(int ncpu, int algo, int preemptive, int a, int aging)
+{
+  if(ncpu < 1 || ncpu > NCPU)
+    return -1;
+  memset(cpus, 0, sizeof(cpus));
+  memset(procs, 0, sizeof(procs));
+  memset(ipi_pending, 0, sizeof(ipi_pending));
+  nprocs = 0;
+  ncpus = ncpu;
+  cur = 0;
+  now = 0;
+  initlock(&proc_sched.lock, "sched");
+  groupinit();
+  for(int i = 0; i < NCPU; i++){
+    initlock(&cpus[i].rq.lock, "runqueue");
+    cpus[i].online = (i < ncpu);
+  }
+  return change_sched(algo, preemptive, a, aging);
+}
+
+int
+sim_setquantum(int algo, int usec)
+{
+  return setquantum(algo, usec);
+}
+
+int
+sim_setcachetol(int usec)
+{
+  return setcachetol(usec);
+}
+
+int
+sim_setlatency(int usec)
+{
+  return setlatency(usec);
+}
+
+int
+sim_setboost(int usec)
+{
+  return setboost(usec);
+}
+
+void
+sim_clock(unsigned long t)
+{
+  now = t;
+}
+
+// a new process, as allocproc() leaves it. returns its handle.
+int
+sim_spawn(int nice)
+{
+  if(nprocs == NPROC)
+    return -1;
+  struct proc *p = &procs[nprocs];
+  initlock(&p->lock, "proc");
+  p->pid = nprocs + 1;
+  p->state = USED;
+  p->heap_index = -1;
+  p->affinity = CPUMASK_ALL;
+  p->last_cpu = -1;
+  p->nice = nice;
+  p->weight = nice_to_weight(nice);
+  return nprocs++;
+}
+
+// make h runnable, as fork() or wakeup() would. interrupts and
+// parents are taken to be on cpu 0.
+void
+sim_wake(int h)
+{
+  cur = 0;
+  put(&procs[h]);
+}
+
+// if cpu is not running anything, run what get() returns, as
+// scheduler() does. returns the handle now running, or -1.
+int
+sim_dispatch(int cpu)
+{
+  struct cpu *c = &cpus[cpu];
+  struct proc *p;
+
+  cur = cpu;
+  if(c->proc == 0){
+    if((p = get()) == 0){
+      c->idle = 1;
+      return -1;
+    }
+    c->idle = 0;
+    p->wait_time += now - p->put_timestamp;
+    p->run_start = now;
+    p->state = RUNNING;
+    c->proc = p;
+    c->need_resched = 0;
+  }
+  return c->proc - procs;
+}
+
+int
+sim_running(int cpu)
+{
+  return cpus[cpu].proc ? cpus[cpu].proc - procs : -1;
+}
+
+// the process on cpu ends its burst, to sleep or to exit.
+void
+sim_block(int cpu, int exiting)
+{
+  struct proc *p = cpus[cpu].proc;
+
+  cur = cpu;
+  acquire(&p->lock);
+  p->state = exiting ? ZOMBIE : SLEEPING;
+  switch_out(p);
+  release(&p->lock);
+}
+
+void
+sim_tick(int cpu)
+{
+  cur = cpu;
+  if(cpus[cpu].proc)
+    timer_routine(cpus[cpu].proc);
+}
+
+// deliver pending ipis, as kerneltrap() and usertrap() would.
+void
+sim_ipis(void)
+{
+  for(int i = 0; i < ncpus; i++){
+    if(!ipi_pending[i])
+      continue;
+    ipi_pending[i] = 0;
+    cur = i;
+    if(cpus[i].proc)
+      ipi_routine(cpus[i].proc);
+  }
+}
+
+// dispatches on a different cpu than the process ran on before.
+unsigned long
+sim_migrations(void)
+{
+  uint64 n = 0;
+
+  for(int i = 0; i < nprocs; i++)
+    n += procs[i].nr_migrations;
+  return n;
+}
+
+void
+sim_proc_stats(int h, struct sim_proc_stats *st)
+{
+  struct proc *p = &procs[h];
+
+  st->run = p->run_time;
+  st->wait = p->wait_time;
+  st->nvcsw = p->nvcsw;
+  st->nivcsw = p->nivcsw;
+}
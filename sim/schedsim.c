@@ -0,0 +1,365 @@
+// Scheduler simulator: replays a workload through kernel/sched.c on
+// the host and reports turnaround, waiting, response time and
+// throughput, so policies and parameters can be compared without
+// booting xv6.
+//
+// A workload is a list of processes, each an arrival time and a
+// sequence of cpu bursts separated by sleeps. It is either generated
+// (-n, -s) or read from a file (-f) with one process per line:
+//
+//   arrival_us burst_us [sleep_us burst_us]...
+//
+// Lines starting with # are ignored. At most NPROC processes.
+//
+// The run is event driven: time jumps to the next burst end, wakeup
+// or timer tick. Every cpu ticks at the same time; wakeups and
+// arrivals are handled on cpu 0.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kernel/param.h"
+#include "sim/sim.h"
+
+#define MAXBURST 64
+
+struct task {
+  unsigned long arrival;
+  int nburst;
+  unsigned long burst[MAXBURST];
+  unsigned long sleep[MAXBURST];   // after burst[i]
+
+  int h;                           // sim handle
+  int cur;                         // burst in progress
+  unsigned long remaining;         // of burst[cur]
+  unsigned long wake_at;           // when sleeping or not yet arrived
+  int waiting;                     // sleeping or not yet arrived
+  int done;
+  int started;
+  unsigned long first_run;
+  unsigned long exit_at;
+};
+
+struct result {
+  double turnaround, wait, response;   // means, ms
+  double max_turnaround;               // ms
+  double throughput;                   // processes per second
+  double nivcsw, migrations;           // totals
+};
+
+static struct task tasks[NPROC];
+static int ntask;
+static int ncpu = 2;
+static unsigned long tick = TICK_USEC * 1000UL;
+static int verbose;
+static int aging;                  // sjf aging rate, see change_sched()
+
+void
+sim_panic(char *s)
+{
+  fprintf(stderr, "schedsim: panic: %s\n", s);
+  exit(2);
+}
+
+static unsigned long rng;
+
+static unsigned long
+rnd(unsigned long lo, unsigned long hi)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return lo + rng % (hi - lo + 1);
+}
+
+// a third cpu-bound processes with a few long bursts, the rest
+// interactive with many short bursts and longer sleeps.
+static void
+generate(int n, unsigned long seed)
+{
+  rng = seed * 2654435761UL + 1;
+  ntask = n;
+  for (int i = 0; i < n; i++) {
+    struct task *t = &tasks[i];
+    memset(t, 0, sizeof(*t));
+    t->arrival = rnd(0, 500) * 1000000UL;
+    if (i % 3 == 0) {
+      t->nburst = rnd(1, 3);
+      for (int b = 0; b < t->nburst; b++) {
+        t->burst[b] = rnd(200, 800) * 1000000UL;
+        t->sleep[b] = rnd(1, 10) * 1000000UL;
+      }
+    } else {
+      t->nburst = rnd(10, 40);
+      for (int b = 0; b < t->nburst; b++) {
+        t->burst[b] = rnd(200, 4000) * 1000UL;
+        t->sleep[b] = rnd(5, 50) * 1000000UL;
+      }
+    }
+  }
+}
+
+static int
+load(char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[4096];
+
+  if (f == 0) {
+    perror(path);
+    return -1;
+  }
+  ntask = 0;
+  while (fgets(line, sizeof(line), f)) {
+    char *s = line, *end;
+    unsigned long v[2 * MAXBURST];
+    int n = 0;
+
+    if (line[0] == '#')
+      continue;
+    while (n < 2 * MAXBURST) {
+      v[n] = strtoul(s, &end, 10);
+      if (end == s)
+        break;
+      s = end;
+      n++;
+    }
+    if (n == 0)
+      continue;
+    if (n < 2 || ntask == NPROC) {
+      fprintf(stderr, "schedsim: %s: bad or too many lines\n", path);
+      fclose(f);
+      return -1;
+    }
+    struct task *t = &tasks[ntask++];
+    memset(t, 0, sizeof(*t));
+    t->arrival = v[0] * 1000UL;
+    for (int i = 1; i < n; i += 2) {
+      t->burst[t->nburst] = v[i] * 1000UL;
+      t->sleep[t->nburst] = (i + 1 < n ? v[i + 1] * 1000UL : 0);
+      t->nburst++;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int
+run(int algo, int preemptive, int a, struct result *r)
+{
+  unsigned long now = 0, next_tick = tick, end = 0;
+  int ndone = 0;
+
+  if (sim_reset(ncpu, algo, preemptive, a, algo == 0 ? aging : 0) < 0)
+    return -1;
+  for (int i = 0; i < ntask; i++) {
+    struct task *t = &tasks[i];
+    if ((t->h = sim_spawn(0)) < 0)
+      return -1;
+    t->cur = 0;
+    t->remaining = t->burst[0];
+    t->wake_at = t->arrival;
+    t->waiting = 1;
+    t->done = t->started = 0;
+  }
+
+  while (ndone < ntask) {
+    unsigned long next = next_tick;
+
+    for (int i = 0; i < ntask; i++) {
+      struct task *t = &tasks[i];
+      if (t->waiting && t->wake_at <= now) {
+        t->waiting = 0;
+        sim_wake(t->h);
+      }
+    }
+    sim_ipis();
+    for (int c = 0; c < ncpu; c++) {
+      int h = sim_dispatch(c);
+      if (h >= 0 && !tasks[h].started) {
+        tasks[h].started = 1;
+        tasks[h].first_run = now;
+      }
+      if (h >= 0 && now + tasks[h].remaining < next)
+        next = now + tasks[h].remaining;
+    }
+    for (int i = 0; i < ntask; i++) {
+      if (tasks[i].waiting && tasks[i].wake_at < next)
+        next = tasks[i].wake_at;
+    }
+
+    for (int c = 0; c < ncpu; c++) {
+      int h = sim_running(c);
+      if (h >= 0)
+        tasks[h].remaining -= next - now;
+    }
+    now = next;
+    sim_clock(now);
+
+    for (int c = 0; c < ncpu; c++) {
+      int h = sim_running(c);
+      if (h < 0 || tasks[h].remaining > 0)
+        continue;
+      struct task *t = &tasks[h];
+      if (t->cur + 1 == t->nburst) {
+        sim_block(c, 1);
+        t->done = 1;
+        t->exit_at = now;
+        ndone++;
+      } else {
+        sim_block(c, 0);
+        t->waiting = 1;
+        t->wake_at = now + t->sleep[t->cur];
+        t->cur++;
+        t->remaining = t->burst[t->cur];
+      }
+    }
+    if (now == next_tick) {
+      for (int c = 0; c < ncpu; c++)
+        sim_tick(c);
+      next_tick += tick;
+    }
+  }
+
+  memset(r, 0, sizeof(*r));
+  for (int i = 0; i < ntask; i++) {
+    struct task *t = &tasks[i];
+    struct sim_proc_stats st;
+
+    sim_proc_stats(t->h, &st);
+    r->turnaround += (t->exit_at - t->arrival) / 1e6;
+    if ((t->exit_at - t->arrival) / 1e6 > r->max_turnaround)
+      r->max_turnaround = (t->exit_at - t->arrival) / 1e6;
+    r->wait += st.wait / 1e6;
+    r->response += (t->first_run - t->arrival) / 1e6;
+    r->nivcsw += st.nivcsw;
+    if (t->exit_at > end)
+      end = t->exit_at;
+    if (verbose)
+      printf("pid=%d turnaround_ms=%.3f wait_ms=%.3f response_ms=%.3f run_ms=%.3f nvcsw=%lu nivcsw=%lu\n",
+             t->h + 1, (t->exit_at - t->arrival) / 1e6, st.wait / 1e6,
+             (t->first_run - t->arrival) / 1e6, st.run / 1e6, st.nvcsw, st.nivcsw);
+  }
+  r->turnaround /= ntask;
+  r->wait /= ntask;
+  r->response /= ntask;
+  r->throughput = ntask / (end / 1e9);
+  r->migrations = sim_migrations();
+  return 0;
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+    "usage: schedsim [-p sjf|psjf|cfs|mlfq|all] [-a a | -A from:to:step] [-g aging] [-c ncpu]\n"
+    "                [-n nproc] [-s seed] [-r runs] [-f workload] [-t tick_us]\n"
+    "                [-q sjf_quantum_us] [-L cfs_latency_ms] [-G cfs_granularity_ms]\n"
+    "                [-Q mlfq_quantum_ms] [-B mlfq_boost_ms] [-T cache_tolerance_us] [-v]\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *policy = "all", *file = 0;
+  int a_from = 50, a_to = 50, a_step = 1;
+  int nproc = 24, runs = 1, quantum = 0, latency = 0, granularity = 0;
+  int mlfq_quantum = 0, boost = 0, cachetol = -1;
+  unsigned long seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    char *o = argv[i];
+    if (strcmp(o, "-v") == 0) {
+      verbose = 1;
+      continue;
+    }
+    if (i + 1 == argc)
+      usage();
+    char *v = argv[++i];
+    if (strcmp(o, "-p") == 0) policy = v;
+    else if (strcmp(o, "-a") == 0) a_from = a_to = atoi(v);
+    else if (strcmp(o, "-g") == 0) aging = atoi(v);
+    else if (strcmp(o, "-A") == 0) {
+      if (sscanf(v, "%d:%d:%d", &a_from, &a_to, &a_step) != 3 || a_step <= 0)
+        usage();
+    }
+    else if (strcmp(o, "-c") == 0) ncpu = atoi(v);
+    else if (strcmp(o, "-n") == 0) nproc = atoi(v);
+    else if (strcmp(o, "-s") == 0) seed = strtoul(v, 0, 10);
+    else if (strcmp(o, "-r") == 0) runs = atoi(v);
+    else if (strcmp(o, "-f") == 0) file = v;
+    else if (strcmp(o, "-t") == 0) tick = strtoul(v, 0, 10) * 1000UL;
+    else if (strcmp(o, "-q") == 0) quantum = atoi(v);
+    else if (strcmp(o, "-L") == 0) latency = atoi(v);
+    else if (strcmp(o, "-G") == 0) granularity = atoi(v);
+    else if (strcmp(o, "-Q") == 0) mlfq_quantum = atoi(v);
+    else if (strcmp(o, "-B") == 0) boost = atoi(v);
+    else if (strcmp(o, "-T") == 0) cachetol = atoi(v);
+    else usage();
+  }
+  if (ncpu < 1 || ncpu > NCPU || nproc < 1 || nproc > NPROC || runs < 1 || tick == 0)
+    usage();
+  if (file) {
+    if (load(file) < 0)
+      exit(1);
+    runs = 1;
+  }
+  if (quantum > 0 && sim_setquantum(0, quantum) < 0)
+    usage();
+  if (cachetol >= 0 && sim_setcachetol(cachetol) < 0)
+    usage();
+  // the cfs granularity may not exceed the latency, whichever is set first
+  if (latency > 0 || granularity > 0) {
+    int l = latency * 1000, g = granularity * 1000;
+    if (!((!g || sim_setquantum(1, g) == 0) && (!l || sim_setlatency(l) == 0)) &&
+        !((!l || sim_setlatency(l) == 0) && (!g || sim_setquantum(1, g) == 0)))
+      usage();
+  }
+  if (mlfq_quantum > 0 && sim_setquantum(2, mlfq_quantum * 1000) < 0)
+    usage();
+  if (boost > 0 && sim_setboost(boost * 1000) < 0)
+    usage();
+
+  struct { char *name; int algo, preemptive; } policies[] = {
+    { "sjf", 0, 0 }, { "psjf", 0, 1 }, { "cfs", 1, 0 }, { "mlfq", 2, 0 },
+  };
+  int matched = 0;
+
+  for (int k = 0; k < 4; k++) {
+    if (strcmp(policy, "all") != 0 && strcmp(policy, policies[k].name) != 0)
+      continue;
+    matched = 1;
+    int algo = policies[k].algo;
+    // only sjf orders its queue by the averaged prediction; one pass is enough for the others
+    int to = (algo == 0 ? a_to : a_from);
+    for (int a = a_from; a <= to; a += a_step) {
+      struct result sum, r;
+      memset(&sum, 0, sizeof(sum));
+      for (int n = 0; n < runs; n++) {
+        if (!file)
+          generate(nproc, seed + n);
+        int ret = run(algo, policies[k].preemptive, a, &r);
+        if (ret < 0) {
+          fprintf(stderr, "schedsim: bad policy parameters\n");
+          exit(1);
+        }
+        sum.turnaround += r.turnaround;
+        sum.max_turnaround += r.max_turnaround;
+        sum.wait += r.wait;
+        sum.response += r.response;
+        sum.throughput += r.throughput;
+        sum.nivcsw += r.nivcsw;
+        sum.migrations += r.migrations;
+      }
+      printf("policy=%s a=%d aging=%d ncpu=%d nproc=%d runs=%d turnaround_ms=%.3f max_turnaround_ms=%.3f wait_ms=%.3f "
+             "response_ms=%.3f throughput=%.3f nivcsw=%.1f migrations=%.1f\n",
+             policies[k].name, a, algo == 0 ? aging : 0, ncpu, ntask, runs,
+             sum.turnaround / runs, sum.max_turnaround / runs, sum.wait / runs, sum.response / runs,
+             sum.throughput / runs, sum.nivcsw / runs, sum.migrations / runs);
+    }
+  }
+  if (!matched)
+    usage();
+  return 0;
+}
@@ -0,0 +1,33 @@
+// Interface between the scheduler simulator's driver (schedsim.c,
+// built against the host libc) and its kernel side (kstubs.c, built
+// against the kernel headers with kernel/sched.c and kernel/cfs.c).
+// The two halves cannot share a translation unit, since defs.h and
+// libc declare printf, exit and friends differently, so only plain
+// C types cross this interface. Times are in nanoseconds.
+
+struct sim_proc_stats {
+  unsigned long run;       // time on a cpu
+  unsigned long wait;      // time RUNNABLE in a run queue
+  unsigned long nvcsw;     // switches out to sleep or exit
+  unsigned long nivcsw;    // preemptions
+};
+
+// kstubs.c
+int  sim_reset(int ncpu, int algo, int preemptive, int a, int aging);
+int  sim_setquantum(int algo, int usec);
+int  sim_setcachetol(int usec);
+int  sim_setlatency(int usec);
+int  sim_setboost(int usec);
+void sim_clock(unsigned long now);
+int  sim_spawn(int nice);
+void sim_wake(int h);
+int  sim_dispatch(int cpu);
+int  sim_running(int cpu);
+void sim_block(int cpu, int exiting);
+void sim_tick(int cpu);
+void sim_ipis(void);
+unsigned long sim_migrations(void);
+void sim_proc_stats(int h, struct sim_proc_stats *st);
+
+// schedsim.c
+void sim_panic(char *s) __attribute__((noreturn));
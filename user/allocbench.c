@@ -0,0 +1,68 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+// allocbench [-w max_workers] [-p pages] [-i iterations]
+//
+// for 1, 2, ... max_workers (default NCPU) workers, each a child
+// process, grow the heap by pages pages with sbrk() and shrink it back,
+// iterations times, so that every page goes through kalloc() and
+// kfree(). prints one line per worker count:
+//   workers=n time_us=t pages_per_sec=r speedup=s
+// where speedup is the rate against one worker. run with as many
+// harts as workers (make CPUS=8) to see how the allocator scales.
+
+static void
+work(int pages, int iters)
+{
+    for (int i = 0; i < iters; i++) {
+        if (sbrk(pages * 4096) == (char*)-1) {
+            fprintf(2, "allocbench: out of memory\n");
+            exit(1);
+        }
+        sbrk(-pages * 4096);
+    }
+    exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int maxw = NCPU, pages = 64, iters = 200;
+    uint64 base = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-w") == 0) maxw = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-p") == 0) pages = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-i") == 0) iters = atoi(argv[i + 1]);
+        else {
+            fprintf(2, "usage: allocbench [-w max_workers] [-p pages] [-i iterations]\n");
+            exit(1);
+        }
+    }
+
+    for (int w = 1; w <= maxw; w++) {
+        uint64 start = uptimens();
+        for (int k = 0; k < w; k++) {
+            int pid = fork();
+            if (pid < 0) {
+                fprintf(2, "allocbench: fork failed\n");
+                exit(1);
+            }
+            if (pid == 0)
+                work(pages, iters);
+        }
+        for (int k = 0; k < w; k++)
+            wait(0);
+        uint64 us = (uptimens() - start) / 1000;
+        if (us == 0) us = 1;
+
+        // every iteration allocates and frees pages pages
+        uint64 rate = (uint64)w * pages * iters * 1000000 / us;
+        if (w == 1) base = rate;
+        printf("workers=%d time_us=%l pages_per_sec=%l speedup=%l.%l\n",
+               w, us, rate, rate / base, rate * 10 / base % 10);
+    }
+    exit(0);
+}
@@ -0,0 +1,31 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+// buddyinfo
+//
+// print how many free blocks of each order the kernel's buddy
+// allocator holds, one line per order:
+//   order=o pages=2^o free=n
+// and the total of free pages. pages cached per cpu by kalloc()
+// are not included.
+int
+main(int argc, char *argv[])
+{
+    uint64 counts[NORDER], total = 0;
+    int n;
+
+    if ((n = buddyinfo(counts, NORDER)) < 0) {
+        fprintf(2, "buddyinfo: failed\n");
+        exit(1);
+    }
+    if (n > NORDER)
+        n = NORDER;
+    for (int o = 0; o < n; o++) {
+        printf("order=%d pages=%d free=%l\n", o, 1 << o, counts[o]);
+        total += counts[o] << o;
+    }
+    printf("total_pages=%l\n", total);
+    exit(0);
+}
@@ -2,22 +2,35 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 
+// chsched <algo> <is_preemptive> <a> [aging]
+//
+// algo is 0 for sjf, 1 for cfs and 2 for mlfq. is_preemptive (0 or 1)
+// makes sjf preempt a process when a shorter one is waiting. a (0..100)
+// is the weight of the last burst in each process's burst prediction,
+// kept under every algorithm. aging (sjf only, 0..1000) is the % of its
+// waiting time taken off a process's predicted burst; 0 disables it.
+// the cfs latency, the mlfq boost period and the quanta are set with
+// timerctl.
 int
 main(int argc, char *argv[])
 {
+    if (argc < 4 || argc > 5) {
+        fprintf(2, "usage: chsched algo is_preemptive a [aging]\n");
+        exit(1);
+    }
     int algo = atoi(argv[1]);
     int is_preemptive = atoi(argv[2]);
     int a = atoi(argv[3]);
+    int aging = (argc > 4 ? atoi(argv[4]) : 0);
 
-    int ret = chsched(algo, is_preemptive, a);
+    int ret = chsched(algo, is_preemptive, a, aging);
     if (ret == 0){
-        printf("algorithm: %s\n", (algo==0?"SJF":"CFS"));
-        if (algo == 0) {
-            printf("is_preemptive: %d\n", is_preemptive);
-            printf("a: %d\n", a);
-        }
+        printf("algorithm: %s\n", (algo==0?"SJF":algo==1?"CFS":"MLFQ"));
+        printf("is_preemptive: %d\n", is_preemptive);
+        printf("a: %d\n", a);
+        if (algo == 0)
+            printf("aging: %d\n", aging);
     }
     printf("return code: %d\n", ret);
     exit(0);
 }
-
@@ -0,0 +1,22 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// gang id cmd [args...]
+// run cmd in gang id: it and the processes it forks are scheduled
+// together. e.g. "gang 1 sh", then pipelines typed at that shell.
+int
+main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(2, "usage: gang id cmd [args...]\n");
+        exit(1);
+    }
+    if (setgang(getpid(), atoi(argv[1])) < 0) {
+        fprintf(2, "gang: bad gang %s\n", argv[1]);
+        exit(1);
+    }
+    exec(argv[2], argv + 2);
+    fprintf(2, "gang: exec %s failed\n", argv[2]);
+    exit(1);
+}
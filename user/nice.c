@@ -0,0 +1,18 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(2, "usage: nice pid value\n");
+        exit(1);
+    }
+    int pid = atoi(argv[1]);
+    int nice = (argv[2][0] == '-' ? -atoi(argv[2] + 1) : atoi(argv[2]));
+
+    int ret = setnice(pid, nice);
+    printf("return code: %d\n", ret);
+    exit(ret == 0 ? 0 : 1);
+}
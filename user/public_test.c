@@ -4,29 +4,6 @@
 
 #define N  1000
 
-uint64 seed = 0x5bd1e995;
-
-int random() {
-    uint64 a = 16807;
-    uint64 m = 2147483647L;
-    seed = (a * seed) % m;
-    uint64 t = seed * 10;
-    while (t < m) {
-        t *= 10;
-    }
-    return t / m;
-}
-
-int do_work(int length) {
-    int ret = 0;
-    for (int i = 0; i < length; i++) {
-        for (int j = 0; j < length; j++) {
-            ret += (j % 2) ? +1 : -1;
-        }
-    }
-    return ret;
-}
-
 void p1(int id, int length) {
     for (int i = 0; i < length; i++) {
         sleep(1);
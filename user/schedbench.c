@@ -0,0 +1,286 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/cputime.h"
+#include "user/user.h"
+
+// schedbench [-p sjf|psjf|cfs|mlfq|all] [-a a] [-g aging] [-c n] [-i n] [-P n] [-s n] [-l length] [-v]
+//
+// fork a mix of cpu-bound (-c), file i/o (-i), pipe i/o (-P) and
+// interactive sleep-heavy (-s) workers, wait for them, and print their
+// turnaround, response (fork to first run) and waiting times. with -p
+// the policy is switched with chsched() first; "all" runs the mix under
+// each policy in turn, and the last one stays in effect. without -p
+// the current policy is used. -a and -g are the sjf averaging
+// parameter and aging rate.
+//
+// every output line is "<record> key=value ...", times in us:
+//   proc     one per worker, with -v; n is the worker id
+//   kind     means over the workers of one kind
+//   summary  means over all workers, makespan and throughput
+
+enum { CPU, IO, PIPE, INTER, NKIND };
+static char *kinds[] = { "cpu", "io", "pipe", "int" };
+
+struct result {
+    int kind;
+    uint64 response;     // fork to first instruction in the child
+    uint64 turnaround;   // fork to exit
+    uint64 run, wait;    // from getcputime()
+};
+
+// name = prefix followed by n in decimal
+static void
+numname(char *name, char *prefix, int n)
+{
+    char digits[12];
+    int i = 0;
+
+    strcpy(name, prefix);
+    do {
+        digits[i++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    name += strlen(name);
+    while (i > 0)
+        *name++ = digits[--i];
+    *name = 0;
+}
+
+static void
+cpu_worker(int length)
+{
+    for (int i = 0; i < length / 2; i++)
+        do_work(length);
+}
+
+// write a small file and read it back, over and over.
+static void
+io_worker(int id, int length)
+{
+    char name[16], buf[512];
+    int fd;
+
+    numname(name, "sbio.", id);
+    memset(buf, 'a' + id % 26, sizeof(buf));
+    for (int i = 0; i < length / 10; i++) {
+        if ((fd = open(name, O_CREATE | O_WRONLY | O_TRUNC)) < 0)
+            exit(1);
+        for (int b = 0; b < 4; b++)
+            write(fd, buf, sizeof(buf));
+        close(fd);
+        if ((fd = open(name, O_RDONLY)) < 0)
+            exit(1);
+        while (read(fd, buf, sizeof(buf)) > 0)
+            ;
+        close(fd);
+    }
+    unlink(name);
+}
+
+// ping-pong messages with an echo child, a little work per round trip.
+static void
+pipe_worker(int length)
+{
+    int to[2], from[2];
+    char buf[64];
+    int n;
+
+    if (pipe(to) < 0 || pipe(from) < 0)
+        exit(1);
+    if (fork() == 0) {
+        close(to[1]);
+        close(from[0]);
+        while ((n = read(to[0], buf, sizeof(buf))) > 0)
+            write(from[1], buf, n);
+        exit(0);
+    }
+    close(to[0]);
+    close(from[1]);
+    memset(buf, 'p', sizeof(buf));
+    for (int i = 0; i < length; i++) {
+        write(to[1], buf, sizeof(buf));
+        for (int got = 0; got < sizeof(buf); got += n) {
+            if ((n = read(from[0], buf + got, sizeof(buf) - got)) <= 0)
+                exit(1);
+        }
+        do_work(length / 20);
+    }
+    close(to[1]);
+    close(from[0]);
+    wait(0);
+}
+
+static void
+interactive_worker(int length)
+{
+    for (int i = 0; i < length / 4; i++) {
+        sleep(random());
+        do_work(length / 10);
+    }
+}
+
+// run one worker and leave its result in file sb.<id>.
+static void
+child(int kind, int id, uint64 forked, int length)
+{
+    struct result r;
+    struct cputime ct;
+    char name[16];
+    int fd;
+
+    r.kind = kind;
+    r.response = uptimens() - forked;
+    seed += id;
+    if (kind == CPU)
+        cpu_worker(length);
+    else if (kind == IO)
+        io_worker(id, length);
+    else if (kind == PIPE)
+        pipe_worker(length);
+    else
+        interactive_worker(length);
+    r.turnaround = uptimens() - forked;
+    getcputime(0, &ct);
+    r.run = ct.run;
+    r.wait = ct.wait;
+
+    numname(name, "sb.", id);
+    if ((fd = open(name, O_CREATE | O_WRONLY | O_TRUNC)) < 0)
+        exit(1);
+    write(fd, &r, sizeof(r));
+    close(fd);
+    exit(0);
+}
+
+static void
+line(char *record, char *policy, char *kind, int n, uint64 turnaround, uint64 response, uint64 wait, uint64 run)
+{
+    printf("%s policy=%s kind=%s n=%d turnaround_us=%l response_us=%l wait_us=%l run_us=%l\n",
+           record, policy, kind, n, turnaround / 1000, response / 1000, wait / 1000, run / 1000);
+}
+
+static int
+bench(char *policy, int nworkers[NKIND], int length, int verbose)
+{
+    struct result r, sum[NKIND];
+    int count[NKIND];
+    int nproc = 0, fd, failed = 0;
+    char name[16];
+    uint64 start = uptimens();
+
+    // stop spawning at the first failed fork: the proc table is full,
+    // and the workers already started are measured as they are.
+    for (int kind = 0; kind < NKIND && !failed; kind++) {
+        for (int i = 0; i < nworkers[kind]; i++) {
+            uint64 forked = uptimens();
+            int pid = fork();
+            if (pid < 0) {
+                fprintf(2, "schedbench: fork failed, %d workers started\n", nproc);
+                failed = 1;
+                break;
+            }
+            if (pid == 0)
+                child(kind, nproc, forked, length);
+            nproc++;
+        }
+    }
+    for (int i = 0; i < nproc; i++)
+        wait(0);
+    uint64 makespan = uptimens() - start;
+
+    memset(sum, 0, sizeof(sum));
+    memset(count, 0, sizeof(count));
+    for (int id = 0; id < nproc; id++) {
+        numname(name, "sb.", id);
+        if ((fd = open(name, O_RDONLY)) < 0 || read(fd, &r, sizeof(r)) != sizeof(r)) {
+            fprintf(2, "schedbench: no result from worker %d\n", id);
+            return -1;
+        }
+        close(fd);
+        unlink(name);
+        if (verbose)
+            line("proc", policy, kinds[r.kind], id, r.turnaround, r.response, r.wait, r.run);
+        sum[r.kind].turnaround += r.turnaround;
+        sum[r.kind].response += r.response;
+        sum[r.kind].wait += r.wait;
+        sum[r.kind].run += r.run;
+        count[r.kind]++;
+    }
+
+    struct result all;
+    memset(&all, 0, sizeof(all));
+    for (int kind = 0; kind < NKIND; kind++) {
+        if (count[kind] == 0)
+            continue;
+        line("kind", policy, kinds[kind], count[kind], sum[kind].turnaround / count[kind],
+             sum[kind].response / count[kind], sum[kind].wait / count[kind], sum[kind].run / count[kind]);
+        all.turnaround += sum[kind].turnaround;
+        all.response += sum[kind].response;
+        all.wait += sum[kind].wait;
+        all.run += sum[kind].run;
+    }
+    if (nproc == 0)
+        return -1;
+    line("summary", policy, "all", nproc, all.turnaround / nproc, all.response / nproc,
+         all.wait / nproc, all.run / nproc);
+    printf("summary policy=%s makespan_us=%l throughput_per_min=%l\n",
+           policy, makespan / 1000, nproc * 60000000000UL / makespan);
+    return failed ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct { char *name; int algo, preemptive; } policies[] = {
+        { "sjf", 0, 0 }, { "psjf", 0, 1 }, { "cfs", 1, 0 }, { "mlfq", 2, 0 },
+    };
+    int nworkers[NKIND] = { 2, 2, 1, 3 };
+    int length = 300, a = 50, aging = 0, verbose = 0;
+    char *policy = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+            continue;
+        }
+        if (i + 1 == argc || argv[i][0] != '-')
+            goto usage;
+        char *v = argv[++i];
+        switch (argv[i-1][1]) {
+            case 'p': policy = v; break;
+            case 'a': a = atoi(v); break;
+            case 'g': aging = atoi(v); break;
+            case 'c': nworkers[CPU] = atoi(v); break;
+            case 'i': nworkers[IO] = atoi(v); break;
+            case 'P': nworkers[PIPE] = atoi(v); break;
+            case 's': nworkers[INTER] = atoi(v); break;
+            case 'l': length = atoi(v); break;
+            default: goto usage;
+        }
+    }
+
+    if (policy == 0)
+        exit(bench("current", nworkers, length, verbose) < 0);
+
+    int matched = 0;
+    for (int k = 0; k < 4; k++) {
+        if (strcmp(policy, "all") != 0 && strcmp(policy, policies[k].name) != 0)
+            continue;
+        matched = 1;
+        int ret = chsched(policies[k].algo, policies[k].preemptive, a, policies[k].algo == 0 ? aging : 0);
+        if (ret != 0) {
+            fprintf(2, "schedbench: chsched %s: %d\n", policies[k].name, ret);
+            exit(1);
+        }
+        if (bench(policies[k].name, nworkers, length, verbose) < 0)
+            exit(1);
+    }
+    if (!matched)
+        goto usage;
+    exit(0);
+
+usage:
+    fprintf(2, "usage: schedbench [-p sjf|psjf|cfs|mlfq|all] [-a a] [-g aging] [-c n] [-i n] [-P n] [-s n] [-l length] [-v]\n");
+    exit(1);
+}
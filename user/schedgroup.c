@@ -0,0 +1,24 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// schedgroup set <pid> <group>                         move pid (and its future children) to group
+// schedgroup ctl <group> <shares> [quota_us period_us] set group's cfs shares and cpu quota
+int
+main(int argc, char *argv[])
+{
+    int ret;
+
+    if (argc == 4 && strcmp(argv[1], "set") == 0) {
+        ret = setgroup(atoi(argv[2]), atoi(argv[3]));
+    } else if (argc == 4 && strcmp(argv[1], "ctl") == 0) {
+        ret = groupctl(atoi(argv[2]), atoi(argv[3]), 0, 0);
+    } else if (argc == 6 && strcmp(argv[1], "ctl") == 0) {
+        ret = groupctl(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+    } else {
+        fprintf(2, "usage: schedgroup set pid group | schedgroup ctl group shares [quota_us period_us]\n");
+        exit(1);
+    }
+    printf("return code: %d\n", ret);
+    exit(ret == 0 ? 0 : 1);
+}
@@ -0,0 +1,86 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/schedstat.h"
+#include "user/user.h"
+
+// schedtop [ticks]
+// print a table of per-process scheduler statistics; with an
+// argument, refresh it every that many ticks until killed.
+// times are in ms, bursts in us.
+
+static char *states[] = { "unused", "used", "sleep", "runble", "run", "zombie" };
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+// print s left-aligned in a column of width w.
+static void
+lcol(char *s, int w)
+{
+    printf("%s ", s);
+    for (int n = strlen(s); n < w; n++)
+        printf(" ");
+}
+
+// print v right-aligned in a column of width w.
+static void
+col(uint64 v, int w)
+{
+    uint64 t = v;
+    int digits = 1;
+    while (t >= 10) {
+        t /= 10;
+        digits++;
+    }
+    for (; digits < w; digits++)
+        printf(" ");
+    printf("%l ", v);
+}
+
+static void
+table(void)
+{
+    struct schedstat st;
+    uint64 run = 0, wait = 0, migrations = 0;
+    int n = 0;
+
+    printf("  pid state  nice grp   run ms  wait ms   vcsw  ivcsw  burst us   pred us   next us cpu  migr name\n");
+    for (int pid = 1; (pid = schedstat(pid, &st)) > 0; pid++) {
+        col(st.pid, 5);
+        lcol(st.state >= 0 && st.state < NELEM(states) ? states[st.state] : "?", 6);
+        printf("%s", st.nice < 0 ? "-" : " ");
+        col(st.nice < 0 ? -st.nice : st.nice, 3);
+        col(st.group, 3);
+        col(st.run / 1000000, 8);
+        col(st.wait / 1000000, 8);
+        col(st.nvcsw, 6);
+        col(st.nivcsw, 6);
+        col(st.last_burst / 1000, 9);
+        col(st.last_burst_aprox / 1000, 9);
+        col(st.burst_aprox / 1000, 9);
+        if (st.cpu < 0)
+            lcol("-", 3);
+        else
+            col(st.cpu, 3);
+        col(st.migrations, 5);
+        printf("%s\n", st.name);
+        run += st.run;
+        wait += st.wait;
+        migrations += st.migrations;
+        n++;
+    }
+    printf("%d processes, run %l ms, wait %l ms, %l migrations\n", n, run / 1000000, wait / 1000000, migrations);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int interval = (argc > 1 ? atoi(argv[1]) : 0);
+
+    table();
+    while (interval > 0) {
+        sleep(interval);
+        printf("\n");
+        table();
+    }
+    exit(0);
+}
@@ -0,0 +1,28 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+// setaffinity pid cpu...: let pid run only on the listed cpus.
+int
+main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(2, "usage: setaffinity pid cpu...\n");
+        exit(1);
+    }
+    int pid = atoi(argv[1]);
+    uint64 mask = 0;
+    for (int i = 2; i < argc; i++) {
+        int cpu = atoi(argv[i]);
+        if (cpu < 0 || cpu >= NCPU) {
+            fprintf(2, "setaffinity: bad cpu %s\n", argv[i]);
+            exit(1);
+        }
+        mask |= 1UL << cpu;
+    }
+
+    int ret = setaffinity(pid, mask);
+    printf("return code: %d\n", ret);
+    exit(ret == 0 ? 0 : 1);
+}
@@ -0,0 +1,30 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/sched.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 4) {
+        fprintf(2, "usage: setsched pid normal|fifo|rr [prio]\n");
+        exit(1);
+    }
+    int pid = atoi(argv[1]);
+    int cls;
+    if (strcmp(argv[2], "normal") == 0)
+        cls = SCHED_NORMAL;
+    else if (strcmp(argv[2], "fifo") == 0)
+        cls = SCHED_FIFO;
+    else if (strcmp(argv[2], "rr") == 0)
+        cls = SCHED_RR;
+    else {
+        fprintf(2, "setsched: unknown class %s\n", argv[2]);
+        exit(1);
+    }
+    int prio = (argc == 4 ? atoi(argv[3]) : 0);
+
+    int ret = setsched(pid, cls, prio);
+    printf("return code: %d\n", ret);
+    exit(ret == 0 ? 0 : 1);
+}
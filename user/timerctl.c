@@ -0,0 +1,32 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// timerctl tick <usec>            set the timer interrupt interval
+// timerctl quantum <algo> <usec>  set the default quantum of sjf (0), cfs (1) or mlfq (2)
+// timerctl cachetol <usec>        set how far a cache-warm process may trail the best one
+// timerctl latency <usec>         set the cfs target latency
+// timerctl boost <usec>           set the mlfq boost period
+int
+main(int argc, char *argv[])
+{
+    int ret;
+
+    if (argc == 3 && strcmp(argv[1], "tick") == 0) {
+        ret = settick(atoi(argv[2]));
+    } else if (argc == 4 && strcmp(argv[1], "quantum") == 0) {
+        ret = setquantum(atoi(argv[2]), atoi(argv[3]));
+    } else if (argc == 3 && strcmp(argv[1], "cachetol") == 0) {
+        ret = setcachetol(atoi(argv[2]));
+    } else if (argc == 3 && strcmp(argv[1], "latency") == 0) {
+        ret = setlatency(atoi(argv[2]));
+    } else if (argc == 3 && strcmp(argv[1], "boost") == 0) {
+        ret = setboost(atoi(argv[2]));
+    } else {
+        fprintf(2, "usage: timerctl tick usec | timerctl quantum algo usec | timerctl cachetol usec\n"
+                   "       timerctl latency usec | timerctl boost usec\n");
+        exit(1);
+    }
+    printf("return code: %d\n", ret);
+    exit(ret == 0 ? 0 : 1);
+}
@@ -0,0 +1,117 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/fcntl.h"
+#include "kernel/schedtrace.h"
+#include "user/user.h"
+
+// tracedump             drain the scheduler trace and print it as a timeline
+// tracedump -o file     drain it to file in binary, to convert later
+// tracedump file        print a binary dump as a timeline
+
+#define MAXEV (NCPU * SCHED_TRACE_LEN)
+
+static char *types[] = {
+  [TR_ENQUEUE]    "enqueue",
+  [TR_DEQUEUE]    "dequeue",
+  [TR_SWITCH_IN]  "switch-in",
+  [TR_SWITCH_OUT] "switch-out",
+  [TR_WAKEUP]     "wakeup",
+  [TR_MIGRATE]    "migrate",
+  [TR_SLEEP]      "sleep",
+  [TR_LOST]       "lost",
+};
+
+static char *states[] = { "unused", "used", "sleeping", "runnable", "running", "zombie" };
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+// each cpu's events come out in order, so a stable insertion sort
+// mostly just interleaves the cpus.
+static void
+sort(struct schedevent *ev, int n)
+{
+    for (int i = 1; i < n; i++) {
+        struct schedevent e = ev[i];
+        int j = i;
+        while (j > 0 && ev[j-1].time > e.time) {
+            ev[j] = ev[j-1];
+            j--;
+        }
+        ev[j] = e;
+    }
+}
+
+static void
+print(struct schedevent *ev, int n)
+{
+    sort(ev, n);
+    for (int i = 0; i < n; i++) {
+        struct schedevent *e = &ev[i];
+        char *type = (e->type < NELEM(types) && types[e->type] ? types[e->type] : "?");
+
+        printf("%l us hart %d %s", (e->time - ev[0].time) / 1000, e->hart, type);
+        if (e->type == TR_LOST) {
+            printf(" %l events\n", e->burst);
+            continue;
+        }
+        printf(" pid %d pred %l us", e->pid, e->burst / 1000);
+        if (e->type == TR_MIGRATE)
+            printf(" from hart %d", e->other);
+        if (e->type == TR_SWITCH_OUT && e->other < NELEM(states))
+            printf(" %s", states[e->other]);
+        printf("\n");
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct schedevent *ev = malloc(MAXEV * sizeof(*ev));
+    int n, fd;
+
+    if (ev == 0) {
+        fprintf(2, "tracedump: out of memory\n");
+        exit(1);
+    }
+
+    if (argc == 1) {
+        n = schedtrace(ev, MAXEV);
+        if (n < 0) {
+            fprintf(2, "tracedump: schedtrace failed\n");
+            exit(1);
+        }
+        print(ev, n);
+    } else if (argc == 3 && strcmp(argv[1], "-o") == 0) {
+        n = schedtrace(ev, MAXEV);
+        if (n < 0) {
+            fprintf(2, "tracedump: schedtrace failed\n");
+            exit(1);
+        }
+        if ((fd = open(argv[2], O_CREATE | O_WRONLY)) < 0) {
+            fprintf(2, "tracedump: cannot create %s\n", argv[2]);
+            exit(1);
+        }
+        if (write(fd, ev, n * sizeof(*ev)) != n * sizeof(*ev)) {
+            fprintf(2, "tracedump: write %s failed\n", argv[2]);
+            exit(1);
+        }
+        close(fd);
+        printf("%d events\n", n);
+    } else if (argc == 2) {
+        if ((fd = open(argv[1], O_RDONLY)) < 0) {
+            fprintf(2, "tracedump: cannot open %s\n", argv[1]);
+            exit(1);
+        }
+        if ((n = read(fd, ev, MAXEV * sizeof(*ev))) < 0) {
+            fprintf(2, "tracedump: read %s failed\n", argv[1]);
+            exit(1);
+        }
+        close(fd);
+        print(ev, n / sizeof(*ev));
+    } else {
+        fprintf(2, "usage: tracedump [-o file | file]\n");
+        exit(1);
+    }
+    exit(0);
+}
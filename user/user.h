@@ -1,5 +1,8 @@
 struct stat;
 struct rtcdate;
+struct cputime;
+struct schedstat;
+struct schedevent;
 
 // system calls
 int fork(void);
@@ -23,7 +26,28 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
-int chsched(int,int,int);
+int chsched(int,int,int,int);
+int setnice(int,int);
+int getcputime(int, struct cputime*);
+int settick(int);
+int setquantum(int,int);
+int schedstat(int, struct schedstat*);
+int schedtrace(struct schedevent*, int);
+uint64 uptimens(void);
+int setsched(int,int,int);
+int setaffinity(int,uint64);
+int setcachetol(int);
+int setgroup(int,int);
+int groupctl(int,int,int,int);
+int setgang(int,int);
+int buddyinfo(uint64*,int);
+int setlatency(int);
+int setboost(int);
+
+// work.c, linked into public_test and schedbench
+extern uint64 seed;
+int random();
+int do_work(int);
 
 // ulib.c
 int stat(const char*, struct stat*);
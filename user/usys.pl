@@ -37,3 +37,19 @@ entry("sbrk");
 entry("sleep");
 entry("uptime");
 entry("chsched");
+entry("setnice");
+entry("getcputime");
+entry("settick");
+entry("setquantum");
+entry("schedstat");
+entry("schedtrace");
+entry("uptimens");
+entry("setsched");
+entry("setaffinity");
+entry("setcachetol");
+entry("setgroup");
+entry("groupctl");
+entry("setgang");
+entry("buddyinfo");
+entry("setlatency");
+entry("setboost");
@@ -0,0 +1,30 @@
+#include "kernel/types.h"
+#include "user/user.h"
+
+// workload helpers shared by the scheduler tests, public_test and
+// schedbench.
+
+uint64 seed = 0x5bd1e995;
+
+// pseudo-random number in 1..9, from a Lehmer generator on seed.
+int random() {
+    uint64 a = 16807;
+    uint64 m = 2147483647L;
+    seed = (a * seed) % m;
+    uint64 t = seed * 10;
+    while (t < m) {
+        t *= 10;
+    }
+    return t / m;
+}
+
+// burn cpu time proportional to length squared.
+int do_work(int length) {
+    int ret = 0;
+    for (int i = 0; i < length; i++) {
+        for (int j = 0; j < length; j++) {
+            ret += (j % 2) ? +1 : -1;
+        }
+    }
+    return ret;
+}